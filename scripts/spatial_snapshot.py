@@ -0,0 +1,25 @@
+"""Reader for the binary spatial snapshots written by lod_gls_circle_square_plot.
+
+See src/spatial_snapshot.h for the format.  Typical use:
+
+    depth, update, cells, workload = read_spatial_snapshot("lod_gls_circle_square_plot.snap")
+
+cells[k] and workload[k] are (x, y) arrays for the k'th record; cells holds
+0 = soma, 1 = germ, 2 = empty.
+"""
+
+import numpy as np
+
+
+def read_spatial_snapshot(filename):
+    with open(filename, "rb") as f:
+        header = np.fromfile(f, dtype="<u4", count=4)
+        if header.size != 4 or header[0].tobytes() != b"EASS" or header[1] != 1:
+            raise ValueError("not a spatial snapshot: %s" % filename)
+        x, y = int(header[2]), int(header[3])
+        record = np.dtype([("lod_depth", "<i4"),
+                           ("update", "<i4"),
+                           ("cells", "u1", (x, y)),
+                           ("workload", "<f4", (x, y))])
+        data = np.fromfile(f, dtype=record)
+    return data["lod_depth"], data["update"], data["cells"], data["workload"]
@@ -16,9 +16,14 @@
 #include <boost/accumulators/statistics/mean.hpp>
 #include <boost/accumulators/statistics/variance.hpp>
 #include <boost/algorithm/string.hpp>
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
 
 #include "resource_consumption.h"
 #include "configurable_mutation.h"
+#include "subpopulation_founder.h"
+#include "task_id.h"
 
 
 #include <ea/digital_evolution.h>
@@ -35,7 +40,6 @@ using namespace ealib;
 using namespace boost::accumulators;
 
 
-LIBEA_MD_DECL(LAST_TASK, "ea.ape.last_task", std::string);
 LIBEA_MD_DECL(GERM_MUTATION_PER_SITE_P, "ea.ape.germ_mutation_per_site_p", double);
 LIBEA_MD_DECL(TASK_LETHALITY_PROB, "ea.ape.task_lethality_prob", double);
 LIBEA_MD_DECL(EACH_TASK_THRESH, "ea.ape.each_task_thresh", double);
@@ -50,16 +54,6 @@ LIBEA_MD_DECL(NOR_LETHALITY_PROB, "ea.ape.nor_lethality_prob", double);
 LIBEA_MD_DECL(XOR_LETHALITY_PROB, "ea.ape.xor_lethality_prob", double);
 LIBEA_MD_DECL(EQUALS_LETHALITY_PROB, "ea.ape.equals_lethality_prob", double);
 
-LIBEA_MD_DECL(NOT_AGE, "ea.ape.not_age", double);
-LIBEA_MD_DECL(NAND_AGE, "ea.ape.nand_age", double);
-LIBEA_MD_DECL(AND_AGE, "ea.ape.and_age", double);
-LIBEA_MD_DECL(ORNOT_AGE, "ea.ape.ornot_age", double);
-LIBEA_MD_DECL(OR_AGE, "ea.ape.or_age", double);
-LIBEA_MD_DECL(ANDNOT_AGE, "ea.ape.andnot_age", double);
-LIBEA_MD_DECL(NOR_AGE, "ea.ape.nor_age", double);
-LIBEA_MD_DECL(XOR_AGE, "ea.ape.xor_age", double);
-LIBEA_MD_DECL(EQUALS_AGE, "ea.ape.equals_age", double);
-
 LIBEA_MD_DECL(RES_INITIAL_AMOUNT, "ea.ape.res_initial_amount", double);
 LIBEA_MD_DECL(RES_INFLOW_AMOUNT, "ea.ape.res_inflow_amount", double);
 LIBEA_MD_DECL(RES_OUTFLOW_FRACTION, "ea.ape.res_outflow_fraction", double);
@@ -86,7 +80,7 @@ struct task_lethality : reaction_event<EA> {
                             typename EA::task_library_type::task_ptr_type task, // task pointer
                             double r, // amount of resource consumed
                             EA& ea) {
-        put<LAST_TASK>(task->name(), ind);
+        put<LAST_TASK_ID>(task_ids::id(*task), ind);
         
         // Grab this task's lethality load
         double lethality_prob = get<TASK_LETHALITY_PROB>(*task);
@@ -98,7 +92,43 @@ struct task_lethality : reaction_event<EA> {
     }
 };
 
+
+/*! First ages of the logic tasks, indexed as in logic_tasks (the column order
+ of tasks_first_age.dat); a negative age means the task has not been performed.
+ */
+struct first_ages {
+    first_ages() {
+        std::fill(age, age+logic_tasks::num_tasks, -1.0);
+    }
+    
+    double age[logic_tasks::num_tasks];
+};
+
+//! Writes the ages space-separated, so that they can be kept as meta-data.
+inline std::ostream& operator<<(std::ostream& out, const first_ages& a) {
+    for(int k=0; k<logic_tasks::num_tasks; ++k) {
+        out << (k ? " " : "") << a.age[k];
+    }
+    return out;
+}
+
+//! Reads ages written by operator<<; whitespace is skipped explicitly, since
+//! lexical_cast reads with noskipws.
+inline std::istream& operator>>(std::istream& in, first_ages& a) {
+    for(int k=0; k<logic_tasks::num_tasks; ++k) {
+        in >> std::ws >> a.age[k];
+    }
+    return in;
+}
+
+LIBEA_MD_DECL(TASK_FIRST_AGES, "ea.ape.task_first_ages", first_ages);
+
+
 /*! Tracks the first age at which an organism performed a task.
+ 
+ All nine ages are kept in one fixed array per organism (TASK_FIRST_AGES), so
+ a repeated task costs one lookup rather than a chain of string compares and
+ an exists check.
  */
 
 template <typename EA>
@@ -111,43 +141,13 @@ struct task_first_age : reaction_event<EA> {
                             typename EA::task_library_type::task_ptr_type task, // task pointer
                             double r,
                             EA& ea) {
-        std::string t = task->name();
-        if (t == "not") {
-            if (!exists<NOT_AGE>(ind)) {
-                put<NOT_AGE>(ind.hw().age(), ind) ;
-            }
-        } else if (t == "nand") {
-            if (!exists<NAND_AGE>(ind)) {
-                put<NAND_AGE>(ind.hw().age(), ind) ;
-            }
-        } else if (t == "and") {
-            if (!exists<AND_AGE>(ind)) {
-                put<AND_AGE>(ind.hw().age(), ind) ;
-            }
-        } else if (t == "ornot") {
-            if (!exists<ORNOT_AGE>(ind)) {
-                put<ORNOT_AGE>(ind.hw().age(), ind) ;
-            }
-        } else if (t == "or") {
-            if (!exists<OR_AGE>(ind)) {
-                put<OR_AGE>(ind.hw().age(), ind) ;
-            }
-        } else if (t == "andnot") {
-            if (!exists<ANDNOT_AGE>(ind)) {
-                put<ANDNOT_AGE>(ind.hw().age(), ind) ;
-            }
-        } else if (t == "nor") {
-            if (!exists<NOR_AGE>(ind)) {
-                put<NOR_AGE>(ind.hw().age(), ind) ;
-            }
-        } else if (t == "xor") {
-            if (!exists<XOR_AGE>(ind)) {
-                put<XOR_AGE>(ind.hw().age(), ind) ;
-            }
-        } else if (t == "equals") {
-            if (!exists<EQUALS_AGE>(ind)) {
-                put<EQUALS_AGE>(ind.hw().age(), ind) ;
-            }
+        int k = logic_tasks::index(task_ids::id(*task));
+        if (k < 0) {
+            return;
+        }
+        first_ages& a = get<TASK_FIRST_AGES>(ind, first_ages());
+        if (a.age[k] < 0.0) {
+            a.age[k] = ind.hw().age();
         }
     }
 };
@@ -162,17 +162,10 @@ struct task_first_age_tracking : end_of_update_event<EA> {
     task_first_age_tracking(EA& ea) : end_of_update_event<EA>(ea), _df("tasks_first_age.dat") {
         _df.add_field("update")
         .add_field("sub_pop_size")
-        .add_field("pop_size")
-        .add_field("not_age")
-        .add_field("nand_age")
-        .add_field("and_age")
-        .add_field("ornot_age")
-        .add_field("or_age")
-        .add_field("andnot_age")
-        .add_field("nor_age")
-        .add_field("xor_age")
-        .add_field("equals_age")
-        ;
+        .add_field("pop_size");
+        for(int k=0; k<logic_tasks::num_tasks; ++k) {
+            _df.add_field(std::string(logic_tasks::name(k)) + "_age");
+        }
     }
     
     //! Destructor.
@@ -182,24 +175,8 @@ struct task_first_age_tracking : end_of_update_event<EA> {
     //! Track resources!
     virtual void operator()(EA& ea) {
         if ((ea.current_update() % 100) == 0) {
-            double t_not = 0.0;
-            double t_not_count = 0.0;
-            double t_nand = 0.0;
-            double t_nand_count = 0.0;
-            double t_and = 0.0;
-            double t_and_count = 0.0;
-            double t_ornot = 0.0;
-            double t_ornot_count = 0.0;
-            double t_or = 0.0;
-            double t_or_count = 0.0;
-            double t_andnot = 0.0;
-            double t_andnot_count = 0.0;
-            double t_nor = 0.0;
-            double t_nor_count = 0.0;
-            double t_xor = 0.0;
-            double t_xor_count = 0.0;
-            double t_equals = 0.0;
-            double t_equals_count = 0.0;
+            double age[logic_tasks::num_tasks] = { 0.0 };
+            double count[logic_tasks::num_tasks] = { 0.0 };
             
             int sub_pop_size = 0;
             int pop_size = 0;
@@ -209,74 +186,26 @@ struct task_first_age_tracking : end_of_update_event<EA> {
                     typename EA::individual_type::individual_type& ind=**j;
                     
                     if (ind.alive()) {
-                    
                         ++pop_size;
-                    
-                        if (exists<NOT_AGE>(ind)) {
-                            t_not += get<NOT_AGE>(ind);
-                            ++t_not_count;
-                        }
-                        if (exists<NAND_AGE>(ind)) {
-                            t_nand += get<NAND_AGE>(ind);
-                            ++t_nand_count;
-                        }
-                        if (exists<AND_AGE>(ind)) {
-                            t_and += get<AND_AGE>(ind);
-                            ++t_and_count;
-                        }
-                        if (exists<ORNOT_AGE>(ind)) {
-                            t_ornot += get<ORNOT_AGE>(ind);
-                            ++t_ornot_count;
-                        }
-                        if (exists<OR_AGE>(ind)) {
-                            t_or += get<OR_AGE>(ind);
-                            ++t_or_count;
-                        }
-                        if (exists<ANDNOT_AGE>(ind)) {
-                            t_andnot += get<ANDNOT_AGE>(ind);
-                            ++t_andnot_count;
-                        }
-                        if (exists<NOR_AGE>(ind)) {
-                            t_nor += get<NOR_AGE>(ind);
-                            ++t_nor_count;
-                        }
-                        if (exists<XOR_AGE>(ind)) {
-                            t_xor += get<XOR_AGE>(ind);
-                            ++t_xor_count;
-                        }
-                        if (exists<EQUALS_AGE>(ind)) {
-                            t_equals += get<EQUALS_AGE>(ind);
-                            ++t_equals_count;
+                        
+                        const first_ages& a = get<TASK_FIRST_AGES>(ind, first_ages());
+                        for(int k=0; k<logic_tasks::num_tasks; ++k) {
+                            if (a.age[k] >= 0.0) {
+                                age[k] += a.age[k];
+                                ++count[k];
+                            }
                         }
                     }
-                    
                 }
             }
             
-            if (t_not_count) { t_not /= t_not_count; }
-            if (t_nand_count) { t_nand /= t_nand_count; }
-            if (t_and_count) { t_and /= t_and_count; }
-            if (t_ornot_count) { t_ornot /= t_ornot_count; }
-            if (t_or_count) { t_or /= t_or_count; }
-            if (t_andnot_count) { t_andnot /= t_andnot_count; }
-            if (t_nor_count) { t_nor /= t_nor_count; }
-            if (t_xor_count) { t_xor /= t_xor_count; }
-            if (t_equals_count) { t_equals /= t_equals_count; }
-
-            
             _df.write(ea.current_update())
             .write(sub_pop_size)
-            .write(pop_size)
-            .write(t_not)
-            .write(t_nand)
-            .write(t_and)
-            .write(t_ornot)
-            .write(t_or)
-            .write(t_andnot)
-            .write(t_nor)
-            .write(t_xor)
-            .write(t_equals)
-            .endl();
+            .write(pop_size);
+            for(int k=0; k<logic_tasks::num_tasks; ++k) {
+                _df.write(count[k] ? (age[k] / count[k]) : 0.0);
+            }
+            _df.endl();
         }
         
     }
@@ -285,108 +214,74 @@ struct task_first_age_tracking : end_of_update_event<EA> {
 };
 
 
-//! Performs group replication using germ lines.
+//! Comma-separated logic tasks required for group replication; overrides the event's default.
+LIBEA_MD_DECL(APE_REPLICATION_TASKS, "ea.ape.replication_tasks", std::string);
+//! Bit k is set once the group's count of logic task k exceeds EACH_TASK_THRESH.
+LIBEA_MD_DECL(TASKS_SATISFIED, "ea.ape.tasks_satisfied", int);
+
+
+/*! Sets a group's TASKS_SATISFIED bit when one of its task counters crosses
+ EACH_TASK_THRESH.  Must be added after task_resource_consumption, whose
+ counters it reads.
+ */
 template <typename EA>
-struct ape_two_task_replication : end_of_update_event<EA> {
-    //! Constructor.
-    ape_two_task_replication(EA& ea) : end_of_update_event<EA>(ea) {
+struct task_threshold_tracking : reaction_event<EA> {
+    task_threshold_tracking(EA& ea) : reaction_event<EA>(ea) {
     }
     
-    
-    //! Destructor.
-    virtual ~ape_two_task_replication() {
-    }
-    
-    //! Perform germline replication among populations.
-    virtual void operator()(EA& ea) {
-        
-        // See if any subpops have exceeded the resource threshold
-        typename EA::population_type offspring;
-        for(typename EA::iterator i=ea.begin(); i!=ea.end(); ++i) {
-            
-            // Do not replicate if the 'founding org' is sterile.
-            if (i->population().size() < 2) continue;
-            
-            double t_not = get<TASK_NOT>(*i, 0.0);
-            double t_nand = get<TASK_NAND>(*i, 0.0);
-            
-            // change this snippet...
-            // each task must have been done more than EACH_TASK_THRESH
-            if ((t_not > get<EACH_TASK_THRESH>(*i)) &&
-                (t_nand > get<EACH_TASK_THRESH>(*i))){
-                
-                
-                typename EA::individual_type::individual_type prop = (*i).founder();
-                prop.repr().resize((*i).founder().hw().original_size());
-                
-                //typename EA::individual_type::individual_type j = **(i->population().begin());
-                //typename EA::individual_type::individual_type prop = j;
-                //prop.repr().resize(j.hw().original_size());
-                prop.hw().initialize();
-                
-                
-                // setup the population (really, an ea):
-                typename EA::individual_ptr_type p = ea.make_individual();
-                
-                // mutate it:
-                configurable_per_site m(get<GERM_MUTATION_PER_SITE_P>(ea));
-                mutate(prop,m,*p);
-                
-                // and fill up the offspring population with copies of the germ:
-                typename EA::individual_type::individual_ptr_type o=p->make_individual(prop.repr());
-                p->append(o);
-                offspring.push_back(p);
-                
-                // reset resource units
-                i->env().reset_resources();
-                put<GROUP_RESOURCE_UNITS>(0,*i);
-                put<TASK_NOT>(0.0,*i);
-                put<TASK_NAND>(0.0,*i);
-                
-                
-                // i == parent individual;
-                typename EA::population_type parent_pop, offspring_pop;
-                parent_pop.push_back(*i.base());
-                offspring_pop.push_back(p);
-                inherits(parent_pop, offspring_pop, ea);
-            }
-        }
-        
-        
-        // select surviving parent groups
-        if (offspring.size() > 0) {
-            int n = get<META_POPULATION_SIZE>(ea) - offspring.size();
-            
-            typename EA::population_type survivors;
-            select_n<selection::random>(ea.population(), survivors, n, ea);
-            
-            // add the offspring to the list of survivors:
-            survivors.insert(survivors.end(), offspring.begin(), offspring.end());
-            
-            // and swap 'em in for the current population:
-            std::swap(ea.population(), survivors);
+    virtual ~task_threshold_tracking() { }
+    virtual void operator()(typename EA::individual_type& ind, // individual
+                            typename EA::task_library_type::task_ptr_type task, // task pointer
+                            double r,
+                            EA& ea) {
+        int k = logic_tasks::index(task_ids::id(*task));
+        if ((k >= 0) && (logic_tasks::count(k, ea) > get<EACH_TASK_THRESH>(ea))) {
+            get<TASKS_SATISFIED>(ea, 0) |= (1 << k);
         }
-        
     }
-    
 };
 
 
-
-//! Performs group replication using germ lines and three tasks.
-template <typename EA>
-struct ape_three_task_replication : end_of_update_event<EA> {
+/*! Performs group replication using germ lines, once a group has performed
+ each of a set of tasks more than EACH_TASK_THRESH times.
+ 
+ Tasks::names() gives the default task set (e.g., "not,nand"); it can be
+ overridden with ea.ape.replication_tasks.  Groups are tested against their
+ TASKS_SATISFIED mask, which task_threshold_tracking maintains, so the check
+ costs the same for any number of tasks.
+ */
+template <typename EA, typename Tasks>
+struct ape_task_replication : end_of_update_event<EA> {
     //! Constructor.
-    ape_three_task_replication(EA& ea) : end_of_update_event<EA>(ea) {
+    ape_task_replication(EA& ea) : end_of_update_event<EA>(ea), _required(0) {
     }
     
     
     //! Destructor.
-    virtual ~ape_three_task_replication() {
+    virtual ~ape_task_replication() {
+    }
+    
+    //! Returns the mask of tasks required for replication.
+    int required(EA& ea) {
+        if (_required == 0) {
+            std::string names = exists<APE_REPLICATION_TASKS>(ea) ? get<APE_REPLICATION_TASKS>(ea) : std::string(Tasks::names());
+            std::vector<std::string> v;
+            boost::algorithm::split(v, names, boost::algorithm::is_any_of(","));
+            for (std::size_t j=0; j<v.size(); ++j) {
+                boost::algorithm::trim(v[j]);
+                int k = logic_tasks::index(v[j]);
+                if (k < 0) {
+                    throw std::invalid_argument("ape_task_replication: unknown task " + v[j]);
+                }
+                _required |= (1 << k);
+            }
+        }
+        return _required;
     }
     
     //! Perform germline replication among populations.
     virtual void operator()(EA& ea) {
+        const int req = required(ea);
         
         // See if any subpops have exceeded the resource threshold
         typename EA::population_type offspring;
@@ -395,23 +290,11 @@ struct ape_three_task_replication : end_of_update_event<EA> {
             // Do not replicate if the 'founding org' is sterile.
             if (i->population().size() < 2) continue;
             
-            double t_not = get<TASK_NOT>(*i, 0.0);
-            double t_nand = get<TASK_NAND>(*i, 0.0);
-            double t_ornot = get<TASK_ORNOT>(*i, 0.0);
-            
-            // change this snippet...
             // each task must have been done more than EACH_TASK_THRESH
-            if ((t_not > get<EACH_TASK_THRESH>(*i)) &&
-                (t_nand > get<EACH_TASK_THRESH>(*i)) &&
-                (t_ornot> get<EACH_TASK_THRESH>(*i))){
+            if ((get<TASKS_SATISFIED>(*i, 0) & req) == req) {
                 
                 
-                typename EA::individual_type::individual_type prop = (*i).founder();
-                prop.repr().resize((*i).founder().hw().original_size());
-                
-                //typename EA::individual_type::individual_type j = **(i->population().begin());
-                //typename EA::individual_type::individual_type prop = j;
-                //prop.repr().resize(j.hw().original_size());
+                typename EA::individual_type::individual_type prop(founder_genome((*i).founder()));
                 prop.hw().initialize();
                 
                 
@@ -430,9 +313,12 @@ struct ape_three_task_replication : end_of_update_event<EA> {
                 // reset resource units
                 i->env().reset_resources();
                 put<GROUP_RESOURCE_UNITS>(0,*i);
-                put<TASK_NOT>(0.0,*i);
-                put<TASK_NAND>(0.0,*i);
-                put<TASK_ORNOT>(0.0,*i);
+                for (int k=0; k<logic_tasks::num_tasks; ++k) {
+                    if (req & (1 << k)) {
+                        logic_tasks::count(k, *i) = 0.0;
+                    }
+                }
+                get<TASKS_SATISFIED>(*i, 0) &= ~req;
                 
                 
                 // i == parent individual;
@@ -460,8 +346,31 @@ struct ape_three_task_replication : end_of_update_event<EA> {
         
     }
     
+    int _required; //!< Mask of required tasks; 0 until first computed.
+};
+
+
+//! Default task sets for ape_task_replication.
+struct not_nand_tasks { static const char* names() { return "not,nand"; } };
+struct not_nand_ornot_tasks { static const char* names() { return "not,nand,ornot"; } };
+
+
+//! Performs group replication using germ lines and two tasks (not, nand).
+template <typename EA>
+struct ape_two_task_replication : ape_task_replication<EA, not_nand_tasks> {
+    ape_two_task_replication(EA& ea) : ape_task_replication<EA, not_nand_tasks>(ea) {
+    }
+};
+
+
+//! Performs group replication using germ lines and three tasks (not, nand, ornot).
+template <typename EA>
+struct ape_three_task_replication : ape_task_replication<EA, not_nand_ornot_tasks> {
+    ape_three_task_replication(EA& ea) : ape_task_replication<EA, not_nand_ornot_tasks>(ea) {
+    }
 };
 
+
 //! Performs group replication using germ lines.
 template <typename EA>
 struct ape_lr_replication : end_of_update_event<EA> {
@@ -489,8 +398,7 @@ struct ape_lr_replication : end_of_update_event<EA> {
                 
                 // grab a copy of the founder!
                 
-                typename EA::individual_type::individual_type prop = (*i).founder();
-                prop.repr().resize((*i).founder().hw().original_size());
+                typename EA::individual_type::individual_type prop(founder_genome((*i).founder()));
                 
                 prop.hw().initialize();
                 
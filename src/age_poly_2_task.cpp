@@ -57,6 +57,7 @@ struct ts_configuration : public abstract_configuration<EA> {
         
         
         add_event<task_resource_consumption>(this,ea);
+        add_event<task_threshold_tracking>(this,ea);
         add_event<task_lethality>(this,ea);
         add_event<task_first_age>(this,ea);
 
@@ -113,7 +114,7 @@ struct mp_configuration : public abstract_configuration<EA> {
 
 //! Meta-population definition.
 typedef meta_population<
-population_lod<population_founder<ea_type> >,
+population_lod<subpopulation_founder<ea_type> >,
 mp_configuration> mea_type;
 
 /*! 
@@ -144,9 +145,9 @@ public:
         
         // age poly specific options
         add_option<TASK_LETHALITY_PROB>(this);
-        add_option<LAST_TASK>(this);
         add_option<GERM_MUTATION_PER_SITE_P>(this);
         add_option<EACH_TASK_THRESH>(this);
+        add_option<APE_REPLICATION_TASKS>(this);
         add_option<ANCESTOR>(this);
         
         add_option<NOT_LETHALITY_PROB>(this);
@@ -160,7 +161,7 @@ public:
     virtual void gather_events(EA& ea) {
         add_event<ape_two_task_replication>(this,ea);
         add_event<task_performed_tracking>(this,ea);
-        add_event<population_founder_event>(this,ea);
+        add_event<founder_event>(this,ea);
         add_event<task_first_age_tracking>(this,ea);
     };
 };
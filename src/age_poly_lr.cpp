@@ -143,7 +143,7 @@ struct mp_configuration : public abstract_configuration<EA> {
 
 //! Meta-population definition.
 typedef meta_population<
-population_lod<population_founder<ea_type> >,
+population_lod<subpopulation_founder<ea_type> >,
 mp_configuration> mea_type;
 
 
@@ -175,7 +175,6 @@ public:
         
         // ape lr specific options
         add_option<TASK_LETHALITY_PROB>(this);
-        add_option<LAST_TASK>(this);
         add_option<GERM_MUTATION_PER_SITE_P>(this);
         add_option<GROUP_REP_THRESHOLD>(this);
         
@@ -202,7 +201,7 @@ public:
     virtual void gather_events(EA& ea) {
         add_event<ape_lr_replication>(this,ea);
         add_event<task_performed_tracking>(this,ea);
-        add_event<population_founder_event>(this,ea);
+        add_event<founder_event>(this,ea);
         add_event<task_first_age_tracking>(this,ea);
     };
 };
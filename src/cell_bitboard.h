@@ -0,0 +1,101 @@
+//
+//  cell_bitboard.h
+//  ealife
+//
+//  Copyright (c) 2013 Michigan State University. All rights reserved.
+//
+
+#ifndef _EALIFE_CELL_BITBOARD_H_
+#define _EALIFE_CELL_BITBOARD_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+#include <boost/cstdint.hpp>
+
+
+//! Returns the number of set bits in w.
+inline std::size_t popcount64(boost::uint64_t w) {
+#if defined(__GNUC__)
+    return static_cast<std::size_t>(__builtin_popcountll(w));
+#else
+    std::size_t c=0;
+    for( ; w; ++c) {
+        w &= w - 1;
+    }
+    return c;
+#endif
+}
+
+
+/*! One bit per cell of a subpopulation's grid, with cell (x,y) at bit
+ y*x_dim + x.  Used to score spatial patterns of task performance by
+ AND-ing a group's per-task board against precomputed pattern masks.
+ */
+class cell_bitboard {
+public:
+    typedef boost::uint64_t word_type;
+
+    //! Constructor; all cells clear.
+    cell_bitboard(int x=0, int y=0) : _x(x), _y(y), _w((x*y + 63) / 64, 0) {
+    }
+
+    int x() const { return _x; }
+    int y() const { return _y; }
+
+    //! Clear all cells.
+    void clear() { std::fill(_w.begin(), _w.end(), 0); }
+
+    //! Set cell (x,y).
+    void set(int x, int y) {
+        std::size_t i = y*_x + x;
+        _w[i >> 6] |= (static_cast<word_type>(1) << (i & 63));
+    }
+
+    //! Set the cell of location l (anything with ->x and ->y).
+    template <typename LocationPtr>
+    void set_at(const LocationPtr& l) { set(l->x, l->y); }
+
+    //! Returns true if cell (x,y) is set.
+    bool test(int x, int y) const {
+        std::size_t i = y*_x + x;
+        return (_w[i >> 6] >> (i & 63)) & 1;
+    }
+
+    //! Returns the number of cells set.
+    std::size_t count() const {
+        std::size_t c=0;
+        for(std::size_t i=0; i<_w.size(); ++i) {
+            c += popcount64(_w[i]);
+        }
+        return c;
+    }
+
+    //! Returns the number of cells set in both this board and m.
+    std::size_t count_and(const cell_bitboard& m) const {
+        std::size_t c=0;
+        for(std::size_t i=0; i<_w.size(); ++i) {
+            c += popcount64(_w[i] & m._w[i]);
+        }
+        return c;
+    }
+
+    //! Returns the complement of this board (within the grid).
+    cell_bitboard operator~() const {
+        cell_bitboard r(_x, _y);
+        for(int y=0; y<_y; ++y) {
+            for(int x=0; x<_x; ++x) {
+                if(!test(x,y)) {
+                    r.set(x,y);
+                }
+            }
+        }
+        return r;
+    }
+
+protected:
+    int _x, _y; //!< Grid dimensions.
+    std::vector<word_type> _w; //!< Cell bits.
+};
+
+#endif
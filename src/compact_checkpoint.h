@@ -0,0 +1,1460 @@
+//
+//  compact_checkpoint.h
+//  ealife
+//
+//  Copyright (c) 2013 Michigan State University. All rights reserved.
+//
+
+#ifndef _EALIFE_COMPACT_CHECKPOINT_H_
+#define _EALIFE_COMPACT_CHECKPOINT_H_
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <boost/archive/text_iarchive.hpp>
+#include <boost/archive/text_oarchive.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/lexical_cast.hpp>
+#include <zlib.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <ea/datafile.h>
+#include <ea/meta_data.h>
+#include <ea/analysis.h>
+
+#include "resource_consumption.h"
+#include "task_id.h"
+#include "subpopulation_founder.h"
+#include "task_switch_totals.h"
+
+using namespace ealib;
+
+
+/*! Compact binary checkpoints.
+
+ A compact checkpoint holds the state of the metapopulation's rng and, for
+ every group of the metapopulation, a set of typed meta-data columns, the
+ state of the group's rng, the founder's genome, and every living organism's
+ genome and typed meta-data columns.  Which meta-data are kept is given by a
+ schema (see checkpoint_traits); hardware state is not kept, so restored
+ organisms start executing from the beginning of their genome.
+
+ All integers are little-endian.  The file starts with a header:
+
+   char[4]  magic "EACK"
+   uint32   version (3)
+   uint32   flags (INDEXED, optionally with DELTA)
+   uint32   update (low, high words)
+   uint32   number of group columns, then for each: uint8 type, string key
+   uint32   number of organism columns, then for each: uint8 type, string key
+   string   keyframe file name (DELTA only)
+   string   metapopulation rng state
+   uint32   number of groups
+
+ followed by one block per group:
+
+   uint32   raw size
+   uint32   packed size
+   uint8    zlib-compressed group[packed size]
+
+ and, if INDEXED, a group index: the file offset of each group's block, then
+ the offset of the index itself (uint64 each, as low and high words).
+
+ Within a group, counts, lengths and integer values are varints (signed
+ values zigzag-encoded), reals are 8-byte IEEE doubles and strings are a
+ length followed by their bytes:
+
+   row      group meta-data
+   string   group rng state
+   varint   founder genome length, then its instructions
+   varint   number of organisms, then for each:
+              varint genome length, then its instructions
+              row    organism meta-data
+
+ A row holds, for each column, a uint8 presence flag followed (if set) by the
+ column's value.  Column types are 'i' (integer or bool), 'd' (real) and 's'
+ (string).
+
+ In a DELTA file, groups are instead encoded relative to the keyframe, so
+ that what did not change since the keyframe is not stored again:
+
+   varint   base: 1 + index of the keyframe group this group's meta-data
+            are relative to, or 0 for none
+   drow     group meta-data, relative to the base group's
+   string   group rng state
+   gref     founder genome
+   varint   number of organisms, then for each:
+              gref   genome
+              drow   organism meta-data, relative to those of the keyframe
+                     organism its genome refers to (if any)
+
+ A gref is either a varint 0 followed by a genome (length, then its
+ instructions), or a varint 1 + keyframe group index followed by a varint
+ slot, meaning the genome in that slot of that keyframe group: slot 0 is the
+ group's founder and slot 1 + i its i'th organism.  A drow holds the number
+ of columns that differ from the row it is relative to (an empty row if
+ none), then for each such column its index, its presence flag and (if set)
+ its value.
+ */
+namespace compact_checkpoint {
+
+    const boost::uint32_t version = 3;
+
+    //! One meta-data value, as stored in a row.
+    struct value {
+        value() : set(false), num(0.0) {
+        }
+
+        bool set; //!< False if the meta-data was not present.
+        double num; //!< Integer or real value.
+        std::string str; //!< String value.
+    };
+
+    typedef std::vector<value> row;
+
+    //! A column: its type and meta-data key.
+    struct column_info {
+        char type;
+        std::string key;
+    };
+
+    typedef std::vector<column_info> columns;
+
+    //! An organism.
+    struct organism_state {
+        std::vector<int> genome;
+        row md;
+    };
+
+    //! A group: its meta-data, rng, founder and organisms.
+    struct group_state {
+        row md;
+        std::string rng; //!< State of the group's rng (see rng_state).
+        std::vector<int> founder;
+        std::vector<organism_state> orgs;
+    };
+
+    //! Contents of a checkpoint.
+    struct image {
+        image() : update(0) {
+        }
+
+        boost::uint64_t update;
+        columns group_cols;
+        columns org_cols;
+        std::string rng; //!< State of the metapopulation's rng.
+        std::vector<group_state> groups;
+    };
+
+
+    //! Returns the state of rng r, as saved by its serialization.
+    template <typename RNG>
+    std::string rng_state(const RNG& r) {
+        std::ostringstream out;
+        {
+            boost::archive::text_oarchive oa(out, boost::archive::no_header);
+            oa << boost::serialization::make_nvp("rng", r);
+        }
+        return out.str();
+    }
+
+    //! Set rng r to state s (see rng_state).
+    template <typename RNG>
+    void set_rng_state(const std::string& s, RNG& r) {
+        std::istringstream in(s);
+        boost::archive::text_iarchive ia(in, boost::archive::no_header);
+        ia >> boost::serialization::make_nvp("rng", r);
+    }
+
+
+    //! Type codes of meta-data value types.
+    inline char type_of(int) { return 'i'; }
+    inline char type_of(unsigned int) { return 'i'; }
+    inline char type_of(long) { return 'i'; }
+    inline char type_of(unsigned long) { return 'i'; }
+    inline char type_of(bool) { return 'i'; }
+    inline char type_of(double) { return 'd'; }
+    inline char type_of(float) { return 'd'; }
+    inline char type_of(const std::string&) { return 's'; }
+
+    //! Store a meta-data value in v.
+    template <typename T>
+    void to_value(const T& t, value& v) { v.num = static_cast<double>(t); }
+    inline void to_value(const std::string& t, value& v) { v.str = t; }
+
+    //! Returns the meta-data value stored in v.
+    template <typename T>
+    struct from_value {
+        static T get(const value& v) { return static_cast<T>(v.num); }
+    };
+    template <>
+    struct from_value<bool> {
+        static bool get(const value& v) { return v.num != 0.0; }
+    };
+    template <>
+    struct from_value<std::string> {
+        static std::string get(const value& v) { return v.str; }
+    };
+
+
+    //! Returns true if a and b hold the same value.
+    inline bool same_value(const value& a, const value& b) {
+        return (a.set == b.set) && (!a.set || ((a.num == b.num) && (a.str == b.str)));
+    }
+
+
+    //! Appends values to a byte buffer.
+    class encoder {
+    public:
+        //! Constructor.
+        encoder(std::string& buf) : _buf(buf) {
+        }
+
+        void put_u8(unsigned char c) { _buf.push_back(static_cast<char>(c)); }
+
+        void put_u32(boost::uint32_t v) {
+            for(int i=0; i<4; ++i) {
+                put_u8((v >> (8*i)) & 0xff);
+            }
+        }
+
+        void put_varint(boost::uint64_t v) {
+            while(v >= 0x80) {
+                put_u8(static_cast<unsigned char>(v | 0x80));
+                v >>= 7;
+            }
+            put_u8(static_cast<unsigned char>(v));
+        }
+
+        void put_sint(boost::int64_t v) {
+            put_varint((static_cast<boost::uint64_t>(v) << 1) ^ static_cast<boost::uint64_t>(v >> 63));
+        }
+
+        void put_real(double d) {
+            boost::uint64_t w;
+            std::memcpy(&w, &d, sizeof(w));
+            put_u32(static_cast<boost::uint32_t>(w));
+            put_u32(static_cast<boost::uint32_t>(w >> 32));
+        }
+
+        void put_string(const std::string& s) {
+            put_varint(s.size());
+            _buf.append(s);
+        }
+
+        void put_genome(const std::vector<int>& g) {
+            put_varint(g.size());
+            for(std::size_t i=0; i<g.size(); ++i) {
+                put_sint(g[i]);
+            }
+        }
+
+        //! Put value v of a column of type t: its presence flag, then the value if set.
+        void put_value(const value& v, char t) {
+            put_u8(v.set);
+            if(!v.set) {
+                return;
+            }
+            switch(t) {
+                case 'i': put_sint(static_cast<boost::int64_t>(v.num)); break;
+                case 'd': put_real(v.num); break;
+                default: put_string(v.str); break;
+            }
+        }
+
+        void put_row(const row& r, const columns& cols) {
+            for(std::size_t i=0; i<cols.size(); ++i) {
+                put_value(r[i], cols[i].type);
+            }
+        }
+
+        //! Put the columns of r that differ from those of base (an empty row if 0).
+        void put_row_delta(const row& r, const row* base, const columns& cols) {
+            value none;
+            std::vector<std::size_t> changed;
+            for(std::size_t i=0; i<cols.size(); ++i) {
+                if(!same_value(r[i], base ? (*base)[i] : none)) {
+                    changed.push_back(i);
+                }
+            }
+            put_varint(changed.size());
+            for(std::size_t i=0; i<changed.size(); ++i) {
+                put_varint(changed[i]);
+                put_value(r[changed[i]], cols[changed[i]].type);
+            }
+        }
+
+    protected:
+        std::string& _buf;
+    };
+
+
+    //! Reads values from a byte buffer.
+    class decoder {
+    public:
+        //! Constructor.
+        decoder(const char* first, const char* last) : _p(first), _end(last) {
+        }
+
+        //! Returns true if the whole buffer has been read.
+        bool done() const { return _p == _end; }
+
+        //! Returns the next unread byte.
+        const char* position() const { return _p; }
+
+        unsigned char get_u8() {
+            if(_p == _end) {
+                throw std::runtime_error("compact_checkpoint::decoder: truncated data");
+            }
+            return static_cast<unsigned char>(*_p++);
+        }
+
+        boost::uint32_t get_u32() {
+            boost::uint32_t v=0;
+            for(int i=0; i<4; ++i) {
+                v |= static_cast<boost::uint32_t>(get_u8()) << (8*i);
+            }
+            return v;
+        }
+
+        boost::uint64_t get_varint() {
+            boost::uint64_t v=0;
+            for(int shift=0; shift<64; shift+=7) {
+                unsigned char c = get_u8();
+                v |= static_cast<boost::uint64_t>(c & 0x7f) << shift;
+                if(!(c & 0x80)) {
+                    return v;
+                }
+            }
+            throw std::runtime_error("compact_checkpoint::decoder: bad varint");
+        }
+
+        boost::int64_t get_sint() {
+            boost::uint64_t v = get_varint();
+            return static_cast<boost::int64_t>(v >> 1) ^ -static_cast<boost::int64_t>(v & 1);
+        }
+
+        double get_real() {
+            boost::uint64_t w = get_u32();
+            w |= static_cast<boost::uint64_t>(get_u32()) << 32;
+            double d;
+            std::memcpy(&d, &w, sizeof(d));
+            return d;
+        }
+
+        std::string get_string() {
+            std::size_t n = get_length();
+            std::string s(_p, n);
+            _p += n;
+            return s;
+        }
+
+        void get_genome(std::vector<int>& g) {
+            g.resize(get_length());
+            for(std::size_t i=0; i<g.size(); ++i) {
+                g[i] = static_cast<int>(get_sint());
+            }
+        }
+
+        //! Get a value of a column of type t (see encoder::put_value).
+        void get_value(value& v, char t) {
+            v = value();
+            v.set = (get_u8() != 0);
+            if(!v.set) {
+                return;
+            }
+            switch(t) {
+                case 'i': v.num = static_cast<double>(get_sint()); break;
+                case 'd': v.num = get_real(); break;
+                default: v.str = get_string(); break;
+            }
+        }
+
+        void get_row(row& r, const columns& cols) {
+            r.resize(cols.size());
+            for(std::size_t i=0; i<cols.size(); ++i) {
+                get_value(r[i], cols[i].type);
+            }
+        }
+
+        //! Get a row relative to base (see encoder::put_row_delta).
+        void get_row_delta(row& r, const row* base, const columns& cols) {
+            if(base) {
+                r = *base;
+            } else {
+                r.assign(cols.size(), value());
+            }
+            std::size_t n = get_varint();
+            for(std::size_t i=0; i<n; ++i) {
+                boost::uint64_t c = get_varint();
+                if(c >= cols.size()) {
+                    throw std::runtime_error("compact_checkpoint::decoder: bad column");
+                }
+                get_value(r[c], cols[c].type);
+            }
+        }
+
+    protected:
+        //! Returns a length, checked against the remaining data.
+        std::size_t get_length() {
+            boost::uint64_t n = get_varint();
+            if(n > static_cast<boost::uint64_t>(_end - _p)) {
+                throw std::runtime_error("compact_checkpoint::decoder: truncated data");
+            }
+            return static_cast<std::size_t>(n);
+        }
+
+        const char* _p;
+        const char* _end;
+    };
+
+
+    //! Encode group g into raw.
+    inline void encode_group(const group_state& g, const columns& gc, const columns& oc, std::string& raw) {
+        raw.clear();
+        encoder e(raw);
+        e.put_row(g.md, gc);
+        e.put_string(g.rng);
+        e.put_genome(g.founder);
+        e.put_varint(g.orgs.size());
+        for(std::size_t i=0; i<g.orgs.size(); ++i) {
+            e.put_genome(g.orgs[i].genome);
+            e.put_row(g.orgs[i].md, oc);
+        }
+    }
+
+    //! Decode the group in [first, last) into g.
+    inline void decode_group(const char* first, const char* last, const columns& gc, const columns& oc, group_state& g) {
+        decoder d(first, last);
+        d.get_row(g.md, gc);
+        g.rng = d.get_string();
+        d.get_genome(g.founder);
+        g.orgs.resize(d.get_varint());
+        for(std::size_t i=0; i<g.orgs.size(); ++i) {
+            d.get_genome(g.orgs[i].genome);
+            d.get_row(g.orgs[i].md, oc);
+        }
+        if(!d.done()) {
+            throw std::runtime_error("compact_checkpoint::decode_group: trailing data");
+        }
+    }
+
+    //! Returns the genome in slot s of group k of keyframe key (see the format above), or 0 if there is none.
+    inline const std::vector<int>* slot_genome(const image& key, std::size_t k, std::size_t s) {
+        if(k >= key.groups.size()) {
+            return 0;
+        }
+        const group_state& g = key.groups[k];
+        if(s == 0) {
+            return &g.founder;
+        }
+        return (s <= g.orgs.size()) ? &g.orgs[s-1].genome : 0;
+    }
+
+    //! Returns the meta-data of the organism in slot s of group k of key, or 0 if there are none.
+    inline const row* slot_md(const image& key, std::size_t k, std::size_t s) {
+        if((k >= key.groups.size()) || (s == 0) || (s > key.groups[k].orgs.size())) {
+            return 0;
+        }
+        return &key.groups[k].orgs[s-1].md;
+    }
+
+
+    /*! A keyframe kept in memory, with its genomes indexed by their hash, so
+     that deltas against it are written without reading it back.
+     */
+    class keyframe {
+    public:
+        //! A genome's location: keyframe group and slot.
+        typedef std::pair<boost::uint32_t, boost::uint32_t> location;
+
+        //! Constructor; an empty keyframe.
+        keyframe() {
+        }
+
+        //! Keep img, written as the file name, as the keyframe; img is left empty.
+        void reset(const std::string& name, image& img) {
+            clear();
+            _name = name;
+            std::swap(_img, img);
+            for(std::size_t k=0; k<_img.groups.size(); ++k) {
+                for(std::size_t s=0; s<=_img.groups[k].orgs.size(); ++s) {
+                    _index.insert(std::make_pair(_hasher(*slot_genome(_img, k, s)), location(k, s)));
+                }
+            }
+        }
+
+        //! Forget the keyframe.
+        void clear() {
+            _name.clear();
+            _img = image();
+            _index.clear();
+        }
+
+        //! Returns true if there is no keyframe.
+        bool empty() const { return _name.empty(); }
+
+        //! Returns the file name of the keyframe.
+        const std::string& name() const { return _name; }
+
+        //! Returns the keyframe's image.
+        const image& img() const { return _img; }
+
+        //! Find genome g in the keyframe; returns false if it is not there.
+        bool find(const std::vector<int>& g, location& l) const {
+            typedef std::multimap<std::size_t, location>::const_iterator index_iterator;
+            std::pair<index_iterator,index_iterator> r = _index.equal_range(_hasher(g));
+            for( ; r.first!=r.second; ++r.first) {
+                if(*slot_genome(_img, r.first->second.first, r.first->second.second) == g) {
+                    l = r.first->second;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+    protected:
+        std::string _name; //!< File name of the keyframe; empty if none.
+        image _img; //!< The keyframe.
+        std::multimap<std::size_t, location> _index; //!< Genome hash to location.
+        boost::hash<std::vector<int> > _hasher;
+    };
+
+
+    /*! Put genome g as a reference into key if it is there, or else in full;
+     returns the meta-data of the organism referred to (or 0).
+     */
+    inline const row* put_genome_ref(encoder& e, const std::vector<int>& g, const keyframe& key) {
+        keyframe::location l;
+        if(!key.find(g, l)) {
+            e.put_varint(0);
+            e.put_genome(g);
+            return 0;
+        }
+        e.put_varint(l.first + 1);
+        e.put_varint(l.second);
+        return slot_md(key.img(), l.first, l.second);
+    }
+
+    //! Get a genome written by put_genome_ref into g; returns the meta-data of the organism referred to (or 0).
+    inline const row* get_genome_ref(decoder& d, std::vector<int>& g, const image& key) {
+        boost::uint64_t k = d.get_varint();
+        if(k == 0) {
+            d.get_genome(g);
+            return 0;
+        }
+        boost::uint64_t s = d.get_varint();
+        const std::vector<int>* kg = slot_genome(key, k-1, s);
+        if(kg == 0) {
+            throw std::runtime_error("compact_checkpoint::get_genome_ref: bad keyframe reference");
+        }
+        g = *kg;
+        return slot_md(key, k-1, s);
+    }
+
+    //! Encode group g, the k'th group, into raw, relative to key.
+    inline void encode_delta_group(const group_state& g, std::size_t k, const keyframe& key,
+                                   const columns& gc, const columns& oc, std::string& raw) {
+        raw.clear();
+        encoder e(raw);
+        const row* base = 0;
+        if(k < key.img().groups.size()) {
+            base = &key.img().groups[k].md;
+            e.put_varint(k + 1);
+        } else {
+            e.put_varint(0);
+        }
+        e.put_row_delta(g.md, base, gc);
+        e.put_string(g.rng);
+        put_genome_ref(e, g.founder, key);
+        e.put_varint(g.orgs.size());
+        for(std::size_t i=0; i<g.orgs.size(); ++i) {
+            e.put_row_delta(g.orgs[i].md, put_genome_ref(e, g.orgs[i].genome, key), oc);
+        }
+    }
+
+    //! Decode the group in [first, last), encoded relative to keyframe key, into g.
+    inline void decode_delta_group(const char* first, const char* last, const image& key,
+                                   const columns& gc, const columns& oc, group_state& g) {
+        decoder d(first, last);
+        const row* base = 0;
+        boost::uint64_t k = d.get_varint();
+        if(k > 0) {
+            if(k > key.groups.size()) {
+                throw std::runtime_error("compact_checkpoint::decode_delta_group: bad keyframe reference");
+            }
+            base = &key.groups[k-1].md;
+        }
+        d.get_row_delta(g.md, base, gc);
+        g.rng = d.get_string();
+        get_genome_ref(d, g.founder, key);
+        g.orgs.resize(d.get_varint());
+        for(std::size_t i=0; i<g.orgs.size(); ++i) {
+            const row* b = get_genome_ref(d, g.orgs[i].genome, key);
+            d.get_row_delta(g.orgs[i].md, b, oc);
+        }
+        if(!d.done()) {
+            throw std::runtime_error("compact_checkpoint::decode_delta_group: trailing data");
+        }
+    }
+
+    //! Compress raw into packed.
+    inline void pack(const std::string& raw, std::string& packed) {
+        uLongf n = compressBound(raw.size());
+        packed.resize(n);
+        if(compress2(reinterpret_cast<Bytef*>(&packed[0]), &n,
+                     reinterpret_cast<const Bytef*>(raw.data()), raw.size(), Z_DEFAULT_COMPRESSION) != Z_OK) {
+            throw std::runtime_error("compact_checkpoint::pack: compression failed");
+        }
+        packed.resize(n);
+    }
+
+    //! Decompress the n packed bytes at packed into raw, which holds raw_size bytes.
+    inline void unpack(const char* packed, std::size_t n, std::size_t raw_size, std::string& raw) {
+        raw.resize(raw_size);
+        uLongf m = raw_size;
+        if((raw_size > 0) &&
+           ((uncompress(reinterpret_cast<Bytef*>(&raw[0]), &m, reinterpret_cast<const Bytef*>(packed), n) != Z_OK) ||
+            (m != raw_size))) {
+            throw std::runtime_error("compact_checkpoint::unpack: corrupt block");
+        }
+    }
+
+    inline void put_columns(encoder& e, const columns& cols) {
+        e.put_u32(cols.size());
+        for(std::size_t i=0; i<cols.size(); ++i) {
+            e.put_u8(cols[i].type);
+            e.put_string(cols[i].key);
+        }
+    }
+
+    inline void get_columns(decoder& d, columns& cols) {
+        cols.resize(d.get_u32());
+        for(std::size_t i=0; i<cols.size(); ++i) {
+            cols[i].type = static_cast<char>(d.get_u8());
+            cols[i].key = d.get_string();
+        }
+    }
+
+    //! Header flag: the file is a delta against a keyframe.
+    const boost::uint32_t DELTA = 0x1;
+
+    //! Header flag: the file ends with a group index.
+    const boost::uint32_t INDEXED = 0x2;
+
+    //! Header of a checkpoint file.
+    struct header {
+        header() : flags(0), update(0) {
+        }
+
+        boost::uint32_t flags;
+        boost::uint64_t update;
+        columns group_cols;
+        columns org_cols;
+        std::string keyframe; //!< File name of the keyframe, for deltas.
+        std::string rng; //!< State of the metapopulation's rng.
+    };
+
+    //! Returns the path of file name f, taken relative to the directory of path.
+    inline std::string sibling(const std::string& path, const std::string& f) {
+        std::string::size_type i = path.rfind('/');
+        return (i == std::string::npos) ? f : path.substr(0, i+1) + f;
+    }
+
+    //! Returns true if rows a and b hold the same values.
+    inline bool same_row(const row& a, const row& b) {
+        if(a.size() != b.size()) {
+            return false;
+        }
+        for(std::size_t i=0; i<a.size(); ++i) {
+            if((a[i].set != b[i].set) || (a[i].set && ((a[i].num != b[i].num) || (a[i].str != b[i].str)))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    //! Returns true if a and b have the same columns.
+    inline bool same_columns(const columns& a, const columns& b) {
+        if(a.size() != b.size()) {
+            return false;
+        }
+        for(std::size_t i=0; i<a.size(); ++i) {
+            if((a[i].type != b[i].type) || (a[i].key != b[i].key)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    //! Unpack the group block at p into raw.
+    inline void read_entry(const char* p, const char* end, std::string& raw) {
+        decoder d(p, end);
+        std::size_t raw_size = d.get_u32();
+        std::size_t n = d.get_u32();
+        if(n > static_cast<std::size_t>(end - d.position())) {
+            throw std::runtime_error("compact_checkpoint::read_entry: truncated file");
+        }
+        unpack(d.position(), n, raw_size, raw);
+    }
+
+    /*! Read the header and raw (encoded, uncompressed) groups of filename;
+     for a delta, the groups are still relative to its keyframe.  Groups are
+     unpacked concurrently when built with OpenMP; the group index lets each
+     be found without scanning the file.
+     */
+    inline void read_raw(const std::string& filename, header& h, std::vector<std::string>& raws) {
+        std::ifstream in(filename.c_str(), std::ios::binary);
+        if(!in) {
+            throw std::runtime_error("compact_checkpoint::read_raw: could not open " + filename);
+        }
+        std::string buf((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        if((buf.size() < 8) || (buf.compare(0, 4, "EACK") != 0)) {
+            throw std::runtime_error("compact_checkpoint::read_raw: not a compact checkpoint: " + filename);
+        }
+
+        const char* end = buf.data() + buf.size();
+        decoder d(buf.data() + 4, end);
+        if(d.get_u32() != version) {
+            throw std::runtime_error("compact_checkpoint::read_raw: unsupported version: " + filename);
+        }
+        h.flags = d.get_u32();
+        h.update = d.get_u32();
+        h.update |= static_cast<boost::uint64_t>(d.get_u32()) << 32;
+        get_columns(d, h.group_cols);
+        get_columns(d, h.org_cols);
+        h.keyframe.clear();
+        if(h.flags & DELTA) {
+            h.keyframe = d.get_string();
+        }
+        h.rng = d.get_string();
+        raws.resize(d.get_u32());
+
+        // locate every group's block, from the index if there is one...
+        std::vector<const char*> entries(raws.size());
+        if(h.flags & INDEXED) {
+            decoder t(end - std::min<std::size_t>(8, end - d.position()), end);
+            boost::uint64_t at = t.get_u32();
+            at |= static_cast<boost::uint64_t>(t.get_u32()) << 32;
+            if(at > buf.size()) {
+                throw std::runtime_error("compact_checkpoint::read_raw: bad index: " + filename);
+            }
+            decoder x(buf.data() + at, end);
+            for(std::size_t i=0; i<entries.size(); ++i) {
+                boost::uint64_t off = x.get_u32();
+                off |= static_cast<boost::uint64_t>(x.get_u32()) << 32;
+                if(off >= at) {
+                    throw std::runtime_error("compact_checkpoint::read_raw: bad index: " + filename);
+                }
+                entries[i] = buf.data() + off;
+            }
+        } else {
+            for(std::size_t i=0; i<entries.size(); ++i) {
+                entries[i] = d.position();
+                d.get_u32();
+                std::size_t n = d.get_u32();
+                if(n > static_cast<std::size_t>(end - d.position())) {
+                    throw std::runtime_error("compact_checkpoint::read_raw: truncated file: " + filename);
+                }
+                d = decoder(d.position() + n, end);
+            }
+        }
+
+        // ...then unpack them (concurrently when built with OpenMP):
+        std::string error;
+#pragma omp parallel for schedule(dynamic, 16)
+        for(int i=0; i<static_cast<int>(raws.size()); ++i) {
+            try {
+                read_entry(entries[i], end, raws[i]);
+            } catch(std::exception& e) {
+#pragma omp critical(compact_checkpoint_error)
+                error = e.what();
+            }
+        }
+        if(!error.empty()) {
+            throw std::runtime_error(error + ": " + filename);
+        }
+    }
+
+    //! Read filename (a keyframe or delta) into img; a delta's keyframe is read too.
+    inline void read_file(const std::string& filename, image& img) {
+        header h;
+        std::vector<std::string> raws;
+        read_raw(filename, h, raws);
+        img.update = h.update;
+        img.group_cols = h.group_cols;
+        img.org_cols = h.org_cols;
+        img.rng = h.rng;
+        img.groups.resize(raws.size());
+
+        image key;
+        if(h.flags & DELTA) {
+            read_file(sibling(filename, h.keyframe), key);
+            if(!same_columns(h.group_cols, key.group_cols) || !same_columns(h.org_cols, key.org_cols)) {
+                throw std::runtime_error("compact_checkpoint::read_file: delta and keyframe columns differ: " + filename);
+            }
+        }
+
+        std::string error;
+#pragma omp parallel for schedule(dynamic, 16)
+        for(int i=0; i<static_cast<int>(raws.size()); ++i) {
+            try {
+                const char* first = raws[i].data();
+                const char* last = first + raws[i].size();
+                if(h.flags & DELTA) {
+                    decode_delta_group(first, last, key, img.group_cols, img.org_cols, img.groups[i]);
+                } else {
+                    decode_group(first, last, img.group_cols, img.org_cols, img.groups[i]);
+                }
+            } catch(std::exception& e) {
+#pragma omp critical(compact_checkpoint_error)
+                error = e.what();
+            }
+        }
+        if(!error.empty()) {
+            throw std::runtime_error(error + ": " + filename);
+        }
+    }
+
+    /*! Write img to filename.
+
+     If key is given, the file is written as a delta against that keyframe
+     (which must have been written to the same directory): genomes found in
+     the keyframe are stored as references to it, and only the meta-data
+     columns that differ from the keyframe's are stored (see the format
+     above).
+     */
+    inline void write_file(const std::string& filename, const image& img, const keyframe* key=0) {
+        if(key && (!same_columns(img.group_cols, key->img().group_cols) || !same_columns(img.org_cols, key->img().org_cols))) {
+            throw std::runtime_error("compact_checkpoint::write_file: keyframe columns differ: " + key->name());
+        }
+
+        std::ofstream out(filename.c_str(), std::ios::binary);
+        if(!out) {
+            throw std::runtime_error("compact_checkpoint::write_file: could not open " + filename);
+        }
+
+        std::string buf, raw, packed;
+        encoder e(buf);
+        buf.append("EACK");
+        e.put_u32(version);
+        e.put_u32(INDEXED | (key ? DELTA : 0));
+        e.put_u32(static_cast<boost::uint32_t>(img.update));
+        e.put_u32(static_cast<boost::uint32_t>(img.update >> 32));
+        put_columns(e, img.group_cols);
+        put_columns(e, img.org_cols);
+        if(key) {
+            e.put_string(key->name());
+        }
+        e.put_string(img.rng);
+        e.put_u32(img.groups.size());
+        out.write(buf.data(), buf.size());
+
+        boost::uint64_t at = buf.size(); // offset of the next block
+        std::vector<boost::uint64_t> index;
+        for(std::size_t i=0; i<img.groups.size(); ++i) {
+            if(key) {
+                encode_delta_group(img.groups[i], i, *key, img.group_cols, img.org_cols, raw);
+            } else {
+                encode_group(img.groups[i], img.group_cols, img.org_cols, raw);
+            }
+            pack(raw, packed);
+            index.push_back(at);
+            buf.clear();
+            e.put_u32(raw.size());
+            e.put_u32(packed.size());
+            out.write(buf.data(), buf.size());
+            out.write(packed.data(), packed.size());
+            at += buf.size() + packed.size();
+        }
+
+        // group index:
+        buf.clear();
+        for(std::size_t i=0; i<index.size(); ++i) {
+            e.put_u32(static_cast<boost::uint32_t>(index[i]));
+            e.put_u32(static_cast<boost::uint32_t>(index[i] >> 32));
+        }
+        e.put_u32(static_cast<boost::uint32_t>(at));
+        e.put_u32(static_cast<boost::uint32_t>(at >> 32));
+        out.write(buf.data(), buf.size());
+        if(!out) {
+            throw std::runtime_error("compact_checkpoint::write_file: could not write " + filename);
+        }
+    }
+
+    /*! The meta-data columns kept for a Holder (group or organism) type.
+     */
+    template <typename Holder>
+    class schema {
+    public:
+        //! Constructor.
+        schema() {
+        }
+
+        //! Keep meta-data MDT.
+        template <typename MDT>
+        schema& add() {
+            column c;
+            c.info.type = type_of(typename MDT::value_type());
+            c.info.key = MDT::key();
+            c.read = &read_md<MDT>;
+            c.write = &write_md<MDT>;
+            _cols.push_back(c);
+            return *this;
+        }
+
+        //! Returns the column layout of this schema.
+        columns info() const {
+            columns r;
+            for(std::size_t i=0; i<_cols.size(); ++i) {
+                r.push_back(_cols[i].info);
+            }
+            return r;
+        }
+
+        //! Read h's meta-data into r.
+        void read(Holder& h, row& r) const {
+            r.resize(_cols.size());
+            for(std::size_t i=0; i<_cols.size(); ++i) {
+                r[i] = value();
+                _cols[i].read(h, r[i]);
+            }
+        }
+
+        /*! Returns, for each of the given columns, the index of the matching
+         column of this schema, or -1 if this schema does not keep it.
+         */
+        std::vector<int> match(const columns& cols) const {
+            std::vector<int> m(cols.size(), -1);
+            for(std::size_t i=0; i<cols.size(); ++i) {
+                for(std::size_t j=0; j<_cols.size(); ++j) {
+                    if(_cols[j].info.key == cols[i].key) {
+                        if(_cols[j].info.type != cols[i].type) {
+                            throw std::runtime_error("compact_checkpoint::schema: type mismatch for " + cols[i].key);
+                        }
+                        m[i] = static_cast<int>(j);
+                    }
+                }
+            }
+            return m;
+        }
+
+        //! Write r, laid out as matched by m, into h's meta-data.
+        void write(const row& r, const std::vector<int>& m, Holder& h) const {
+            for(std::size_t i=0; i<r.size(); ++i) {
+                if(m[i] >= 0) {
+                    _cols[m[i]].write(r[i], h);
+                }
+            }
+        }
+
+    protected:
+        template <typename MDT>
+        static void read_md(Holder& h, value& v) {
+            v.set = exists<MDT>(h);
+            if(v.set) {
+                to_value(get<MDT>(h), v);
+            }
+        }
+
+        template <typename MDT>
+        static void write_md(const value& v, Holder& h) {
+            if(v.set) {
+                put<MDT>(from_value<typename MDT::value_type>::get(v), h);
+            }
+        }
+
+        struct column {
+            column_info info;
+            void (*read)(Holder&, value&);
+            void (*write)(const value&, Holder&);
+        };
+
+        std::vector<column> _cols;
+    };
+
+} // compact_checkpoint
+
+//! Period (in updates) at which compact checkpoints are written; 0 disables.
+LIBEA_MD_DECL(COMPACT_CHECKPOINT_PERIOD, "ea.checkpoint.compact_period", int);
+//! Compact checkpoint to restore the metapopulation from; empty for none.
+LIBEA_MD_DECL(COMPACT_CHECKPOINT_INPUT, "ea.checkpoint.compact_input", std::string);
+//! If true, compact checkpoints are written by a forked child process.
+LIBEA_MD_DECL(COMPACT_CHECKPOINT_ASYNC, "ea.checkpoint.compact_async", bool);
+//! Every n'th compact checkpoint is a full keyframe, the rest are deltas; 0 or 1 for all full.
+LIBEA_MD_DECL(COMPACT_CHECKPOINT_KEYFRAME, "ea.checkpoint.compact_keyframe", int);
+
+
+/*! Meta-data kept in compact checkpoints of metapopulation EA: the group's
+ rng seed (the rng's state is kept separately), resources and task counters,
+ and each organism's saved resources, last task and task counters.  Binaries
+ that need more specialize checkpoint_traits for their metapopulation type.
+ */
+template <typename EA>
+struct default_checkpoint_traits {
+    typedef typename EA::individual_type group_type;
+    typedef typename group_type::individual_type organism_type;
+
+    static void group_columns(compact_checkpoint::schema<group_type>& s) {
+        s.template add<RNG_SEED>();
+        s.template add<GROUP_RESOURCE_UNITS>();
+        task_columns(s);
+    }
+
+    static void organism_columns(compact_checkpoint::schema<organism_type>& s) {
+        s.template add<SAVED_RESOURCES>();
+        s.template add<LAST_TASK_ID>();
+        task_columns(s);
+    }
+
+    //! Add the logic task counters.
+    template <typename Holder>
+    static void task_columns(compact_checkpoint::schema<Holder>& s) {
+        s.template add<TASK_NOT>();
+        s.template add<TASK_NAND>();
+        s.template add<TASK_AND>();
+        s.template add<TASK_ORNOT>();
+        s.template add<TASK_OR>();
+        s.template add<TASK_ANDNOT>();
+        s.template add<TASK_NOR>();
+        s.template add<TASK_XOR>();
+        s.template add<TASK_EQUALS>();
+    }
+};
+
+template <typename EA>
+struct checkpoint_traits : default_checkpoint_traits<EA> {
+};
+
+
+/*! Saves and restores a metapopulation of subpopulation_founders as compact
+ checkpoints.
+
+ The rngs of the metapopulation and of every group are saved and restored
+ with their full state, so they carry on where they left off.  Organisms'
+ hardware state and positions and the groups' environment (e.g., resource
+ levels) are not kept, so a restored run does not reproduce the original
+ run exactly.
+
+ ea's update counter is not restored by load(); instead, the checkpointer
+ remembers how far the checkpoint's update is ahead of ea's, and update()
+ (which capture() records) carries on counting from the checkpoint.
+ */
+template <typename EA>
+class compact_checkpointer {
+public:
+    typedef checkpoint_traits<EA> traits_type;
+    typedef typename traits_type::group_type group_type;
+    typedef typename traits_type::organism_type organism_type;
+    typedef typename organism_type::representation_type representation_type;
+
+    //! Constructor.
+    compact_checkpointer() : _update_offset(0) {
+        traits_type::group_columns(_gs);
+        traits_type::organism_columns(_os);
+    }
+
+    //! Returns ea's current update, counted from the last checkpoint loaded (if any).
+    boost::uint64_t update(EA& ea) const {
+        return static_cast<boost::uint64_t>(static_cast<boost::int64_t>(ea.current_update()) + _update_offset);
+    }
+
+    /*! Copy ea's groups into img.  Dead organisms are not kept, and each
+     organism's genome is kept at its original size (see restore()).
+     */
+    void capture(EA& ea, compact_checkpoint::image& img) {
+        img.update = update(ea);
+        img.rng = compact_checkpoint::rng_state(ea.rng());
+        img.group_cols = _gs.info();
+        img.org_cols = _os.info();
+        img.groups.resize(ea.population().size());
+
+        std::size_t k=0;
+        for(typename EA::iterator i=ea.begin(); i!=ea.end(); ++i, ++k) {
+            compact_checkpoint::group_state& g = img.groups[k];
+            _gs.read(*i, g.md);
+            g.rng = compact_checkpoint::rng_state(i->rng());
+            representation_type f = founder_genome(i->founder());
+            g.founder.assign(f.begin(), f.end());
+
+            g.orgs.clear();
+            for(typename group_type::population_type::iterator j=i->population().begin(); j!=i->population().end(); ++j) {
+                if(!(**j).alive()) {
+                    continue;
+                }
+                // an organism that is copying itself has already grown its genome
+                // by the offspring's space; only its own genome is kept:
+                const representation_type& r = (**j).repr();
+                std::size_t n = std::min(r.size(), static_cast<std::size_t>((**j).hw().original_size()));
+                g.orgs.push_back(compact_checkpoint::organism_state());
+                g.orgs.back().genome.assign(r.begin(), r.begin() + n);
+                _os.read(**j, g.orgs.back().md);
+            }
+        }
+    }
+
+    /*! Replace ea's groups with those in img.  Organisms are placed by the
+     environment and start from the beginning of their genome; meta-data
+     in img that this binary does not keep is ignored.
+     */
+    void restore(const compact_checkpoint::image& img, EA& ea) {
+        std::vector<int> gm = _gs.match(img.group_cols);
+        std::vector<int> om = _os.match(img.org_cols);
+
+        typename EA::population_type pop;
+        for(std::size_t k=0; k<img.groups.size(); ++k) {
+            const compact_checkpoint::group_state& g = img.groups[k];
+            typename EA::individual_ptr_type p = ea.make_individual();
+            _gs.write(g.md, gm, *p);
+            compact_checkpoint::set_rng_state(g.rng, p->rng());
+
+            if(!g.founder.empty()) {
+                typename group_type::individual_ptr_type f = p->make_individual(representation_type(g.founder.begin(), g.founder.end()));
+                f->hw().initialize();
+                p->founder() = *f;
+            }
+
+            for(std::size_t j=0; j<g.orgs.size(); ++j) {
+                typename group_type::individual_ptr_type o = p->make_individual(representation_type(g.orgs[j].genome.begin(), g.orgs[j].genome.end()));
+                o->hw().initialize();
+                _os.write(g.orgs[j].md, om, *o);
+                p->append(o);
+            }
+            // restored organisms are not born, so count them here:
+            ts_count_totals(p->population(), *p);
+            pop.push_back(p);
+        }
+        std::swap(ea.population(), pop);
+
+        // last, as making the groups above may draw from it:
+        compact_checkpoint::set_rng_state(img.rng, ea.rng());
+    }
+
+    /*! Write a compact checkpoint of ea to filename; if key is given, as a
+     delta against it (see compact_checkpoint::write_file).
+     */
+    void save(EA& ea, const std::string& filename, const compact_checkpoint::keyframe* key=0) {
+        compact_checkpoint::image img;
+        capture(ea, img);
+        compact_checkpoint::write_file(filename, img, key);
+    }
+
+    /*! Restore ea from the compact checkpoint in filename.  The file is
+     unpacked and decoded concurrently (see compact_checkpoint::read_file);
+     only building the subpopulations themselves is serial.
+     */
+    void load(const std::string& filename, EA& ea) {
+        compact_checkpoint::image img;
+        compact_checkpoint::read_file(filename, img);
+        restore(img, ea);
+        _update_offset = static_cast<boost::int64_t>(img.update) - static_cast<boost::int64_t>(ea.current_update());
+    }
+
+protected:
+    compact_checkpoint::schema<group_type> _gs; //!< Group meta-data columns.
+    compact_checkpoint::schema<organism_type> _os; //!< Organism meta-data columns.
+    boost::int64_t _update_offset; //!< Update of the last checkpoint loaded, less ea's update when it was loaded.
+};
+
+
+/*! Runs checkpoint writes in a forked child process.
+
+ fork() gives the child a copy-on-write snapshot of the whole process, so the
+ child can serialize the metapopulation as it was at the checkpoint while the
+ parent keeps updating; the parent only pays for the fork itself and for the
+ pages it modifies while the child is running.  At most one child runs at a
+ time: starting a write first waits for the previous one.  The child leaves
+ with _exit(), so it never flushes the parent's buffered datafiles; its exit
+ status (nonzero if f threw) is returned by wait().
+ */
+class forked_writer {
+public:
+    //! Constructor.
+    forked_writer() : _child(-1) {
+    }
+
+    //! Destructor; waits for the last write to finish.
+    ~forked_writer() {
+        if(!wait()) {
+            std::cerr << "forked_writer: background write failed" << std::endl;
+        }
+    }
+
+    /*! Wait for the running write (if any) to finish.  Returns false if it
+     failed, i.e., the child did not exit normally with status 0.
+     */
+    bool wait() {
+        if(_child <= 0) {
+            return true;
+        }
+        int status;
+        pid_t r;
+        while(((r = waitpid(_child, &status, 0)) < 0) && (errno == EINTR)) {
+        }
+        _child = -1;
+        return (r > 0) && WIFEXITED(status) && (WEXITSTATUS(status) == 0);
+    }
+
+    /*! Call f() in a child process.  Returns false (and does not call f) if
+     the process could not be forked.  Any running write is waited for first;
+     call wait() beforehand to learn whether it succeeded.
+     */
+    template <typename F>
+    bool run(F f) {
+        wait();
+        pid_t pid = fork();
+        if(pid < 0) {
+            return false;
+        }
+        if(pid == 0) {
+            int r=0;
+            try {
+                f();
+            } catch(std::exception& e) {
+                // not std::cerr, which would flush the parent's copy of std::cout:
+                std::string m = std::string(e.what()) + "\n";
+                if(::write(STDERR_FILENO, m.data(), m.size()) < 0) {
+                }
+                r=1;
+            } catch(...) {
+                r=1;
+            }
+            _exit(r);
+        }
+        _child = pid;
+        return true;
+    }
+
+protected:
+    pid_t _child; //!< Running child, or -1.
+};
+
+
+/*! Writes a compact checkpoint every ea.checkpoint.compact_period updates, and
+ restores the metapopulation from ea.checkpoint.compact_input (if set) when
+ the event is created, i.e., once the initial population has been made and
+ before the first update, so that no update runs on the initial population
+ (see compact_checkpointer for what is and is not restored).  ea's update
+ counter is not restored, but later checkpoints are numbered (and named)
+ counting on from the restored one (see compact_checkpointer::update), so they
+ do not collide with the files of the run being continued.  An existing
+ checkpoint file is never overwritten: that write fails instead.
+
+ With ea.checkpoint.compact_async, checkpoints are written by a forked_writer
+ so that the run does not block on them (falling back to writing in-process
+ if fork fails).  Either way, a checkpoint is written to a temporary name and
+ renamed once complete, so a checkpoint file that exists is always whole.  A
+ failed background write is reported (on stderr) when the next checkpoint is
+ due, and the run continues; a failed in-process write throws.
+
+ With ea.checkpoint.compact_keyframe = n > 1, only every n'th checkpoint is
+ written in full; the others are deltas against the last full one, and
+ restoring from a delta reads its keyframe too.  Keep each keyframe for as
+ long as its deltas are needed.  The last keyframe is kept in memory (it is
+ captured by the run itself, not by the forked_writer), so deltas are written
+ without reading it back.  A keyframe only becomes the base for deltas once it
+ has been written; if its write fails, the next checkpoint is written in full.
+ */
+template <typename EA>
+struct compact_checkpoint_event : end_of_update_event<EA> {
+    //! Constructor.
+    compact_checkpoint_event(EA& ea) : end_of_update_event<EA>(ea), _since_keyframe(0), _pending_keyframe(false) {
+        std::string in = get<COMPACT_CHECKPOINT_INPUT>(ea, std::string());
+        if(!in.empty()) {
+            _ckpt.load(in, ea);
+        }
+    }
+
+    //! Destructor.
+    virtual ~compact_checkpoint_event() {
+    }
+
+    virtual void operator()(EA& ea) {
+        int period = get<COMPACT_CHECKPOINT_PERIOD>(ea, 0);
+        if((period > 0) && ((ea.current_update() % period) == 0)) {
+            // collect the previous background write, if any:
+            if(!_writer.wait()) {
+                std::cerr << "compact_checkpoint_event: background write of " << _pending << " failed" << std::endl;
+                if(_pending_keyframe) {
+                    _keyframe.clear();
+                }
+            }
+
+            std::string f = filename(ea, _ckpt.update(ea));
+            int keyframe_period = get<COMPACT_CHECKPOINT_KEYFRAME>(ea, 0);
+            _pending = f;
+            _pending_keyframe = _keyframe.empty() || (_since_keyframe >= keyframe_period);
+            if(keyframe_period <= 1) {
+                _keyframe.clear();
+            } else if(_pending_keyframe) {
+                compact_checkpoint::image img;
+                _ckpt.capture(ea, img);
+                _keyframe.reset(f.substr(f.rfind('/') + 1), img);
+                _since_keyframe = 0;
+            }
+            save_op op(_ckpt, ea, f, _keyframe.empty() ? 0 : &_keyframe, _pending_keyframe);
+
+            if(!get<COMPACT_CHECKPOINT_ASYNC>(ea, false) || !_writer.run(op)) {
+                op();
+            }
+            ++_since_keyframe;
+        }
+    }
+
+    /*! Writes a checkpoint to a temporary file, then renames it: if full,
+     keyframe k itself (or ea, without one), or else a delta of ea against k.
+     */
+    struct save_op {
+        save_op(compact_checkpointer<EA>& c, EA& ea, const std::string& f, const compact_checkpoint::keyframe* k, bool full)
+        : _c(&c), _ea(&ea), _f(f), _k(k), _full(full) {
+        }
+
+        void operator()() {
+            struct stat st;
+            if(stat(_f.c_str(), &st) == 0) {
+                throw std::runtime_error("compact_checkpoint_event: " + _f + " exists; not overwriting it");
+            }
+            std::string tmp = _f + ".tmp";
+            if(!_full) {
+                _c->save(*_ea, tmp, _k);
+            } else if(_k) {
+                compact_checkpoint::write_file(tmp, _k->img());
+            } else {
+                _c->save(*_ea, tmp);
+            }
+            if(std::rename(tmp.c_str(), _f.c_str()) != 0) {
+                throw std::runtime_error("compact_checkpoint_event: could not rename " + tmp);
+            }
+        }
+
+        compact_checkpointer<EA>* _c;
+        EA* _ea;
+        std::string _f; //!< Checkpoint file name.
+        const compact_checkpoint::keyframe* _k; //!< Keyframe, or 0.
+        bool _full; //!< True to write the keyframe itself.
+    };
+
+    //! Returns the name of ea's compact checkpoint for the given update.
+    static std::string filename(EA& ea, boost::uint64_t update) {
+        return get<CHECKPOINT_PREFIX>(ea, std::string("checkpoint")) + "-"
+        + boost::lexical_cast<std::string>(update) + ".eack";
+    }
+
+    compact_checkpoint::keyframe _keyframe; //!< Last keyframe.
+    int _since_keyframe; //!< Checkpoints written since (and including) the last keyframe.
+    std::string _pending; //!< File name of the last checkpoint started.
+    bool _pending_keyframe; //!< True if the last checkpoint started is a keyframe.
+    compact_checkpointer<EA> _ckpt;
+    forked_writer _writer; //!< Background writer for ea.checkpoint.compact_async.
+};
+
+
+namespace ealib {
+    namespace analysis {
+
+        /*! Converts a checkpoint (loaded as usual) into a compact checkpoint,
+         named as by compact_checkpoint_event.
+         */
+        LIBEA_ANALYSIS_TOOL(compact_checkpoint_convert) {
+            compact_checkpointer<EA> c;
+            c.save(ea, compact_checkpoint_event<EA>::filename(ea, ea.current_update()));
+        }
+
+        /*! Save/load round trip of a compact checkpoint.
+
+         ea (loaded as usual) is captured, written to a compact checkpoint,
+         restored from that file and captured again; every group's meta-data,
+         founder, and organisms' genomes and meta-data must come back
+         identical, as must the rngs' states.  In addition, each restored organism's whole genome must be
+         the genome the organism was born with (its genome cut to its original
+         size, before saving), so organisms that were copying themselves come
+         back as they were.  Mismatches are counted in
+         compact_checkpoint_roundtrip.dat, and any mismatch is an error.
+         */
+        LIBEA_ANALYSIS_TOOL(compact_checkpoint_roundtrip) {
+            using namespace compact_checkpoint;
+            typedef typename compact_checkpointer<EA>::group_type group_type;
+            compact_checkpointer<EA> c;
+            image before, after;
+            c.capture(ea, before);
+
+            // genomes of the living organisms, as born:
+            std::vector<std::vector<int> > born;
+            for(typename EA::iterator i=ea.begin(); i!=ea.end(); ++i) {
+                for(typename group_type::population_type::iterator j=i->population().begin(); j!=i->population().end(); ++j) {
+                    if((**j).alive()) {
+                        std::size_t n = std::min((**j).repr().size(), static_cast<std::size_t>((**j).hw().original_size()));
+                        born.push_back(std::vector<int>((**j).repr().begin(), (**j).repr().begin() + n));
+                    }
+                }
+            }
+
+            std::string f = compact_checkpoint_event<EA>::filename(ea, ea.current_update()) + ".roundtrip";
+            write_file(f, before);
+            c.load(f, ea);
+            std::remove(f.c_str());
+            c.capture(ea, after);
+
+            std::size_t orgs=0, genomes=0, md=0, rngs=(before.rng != after.rng);
+            std::size_t o=0;
+            for(typename EA::iterator i=ea.begin(); i!=ea.end(); ++i) {
+                for(typename group_type::population_type::iterator j=i->population().begin(); j!=i->population().end(); ++j, ++o) {
+                    std::vector<int> g((**j).repr().begin(), (**j).repr().end());
+                    genomes += (o >= born.size()) || (g != born[o]) || (static_cast<std::size_t>((**j).hw().original_size()) != g.size());
+                }
+            }
+            if(o != born.size()) {
+                throw std::runtime_error("compact_checkpoint_roundtrip: number of organisms differs");
+            }
+            if(before.groups.size() != after.groups.size()) {
+                throw std::runtime_error("compact_checkpoint_roundtrip: number of groups differs");
+            }
+            for(std::size_t k=0; k<before.groups.size(); ++k) {
+                const group_state& a = before.groups[k];
+                const group_state& b = after.groups[k];
+                if(a.orgs.size() != b.orgs.size()) {
+                    throw std::runtime_error("compact_checkpoint_roundtrip: group sizes differ");
+                }
+                md += !same_row(a.md, b.md);
+                rngs += (a.rng != b.rng);
+                genomes += (a.founder != b.founder);
+                for(std::size_t j=0; j<a.orgs.size(); ++j, ++orgs) {
+                    genomes += (a.orgs[j].genome != b.orgs[j].genome);
+                    md += !same_row(a.orgs[j].md, b.orgs[j].md);
+                }
+            }
+
+            datafile df("compact_checkpoint_roundtrip.dat");
+            df.add_field("groups")
+            .add_field("organisms")
+            .add_field("genome_mismatches")
+            .add_field("md_mismatches")
+            .add_field("rng_mismatches");
+            df.write(before.groups.size())
+            .write(orgs)
+            .write(genomes)
+            .write(md)
+            .write(rngs)
+            .endl();
+
+            if((genomes > 0) || (md > 0) || (rngs > 0)) {
+                throw std::runtime_error("compact_checkpoint_roundtrip: restored state differs");
+            }
+        }
+
+    }
+}
+
+#endif
@@ -0,0 +1,79 @@
+//
+//  fitness_tournament.h
+//  ealife
+//
+//  Copyright (c) 2013 Michigan State University. All rights reserved.
+//
+
+#ifndef _EALIFE_FITNESS_TOURNAMENT_H_
+#define _EALIFE_FITNESS_TOURNAMENT_H_
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <vector>
+#include <ea/meta_data.h>
+#include <ea/selection/tournament.h>
+
+using namespace ealib;
+
+
+/*! Tournament selection over a precomputed fitness vector.
+
+ Drop-in replacement for selection::tournament<access::meta_data<...> > in
+ the metapopulation competitions: fitness[i] is the fitness of src[i], so
+ comparisons read a contiguous array instead of looking up (and first storing)
+ each group's fitness in its meta-data.  As with selection::tournament, each
+ tournament samples ea.selection.tournament.n individuals without replacement
+ and the best ea.selection.tournament.k of them are selected.
+
+ The fitness vector must be indexed the same as the population passed to
+ operator(), and must outlive the selection.
+ */
+struct fitness_tournament {
+    //! Constructor.
+    fitness_tournament(const std::vector<double>& fitness) : _fitness(&fitness) {
+    }
+
+    //! Orders indices by decreasing fitness.
+    struct by_fitness {
+        by_fitness(const std::vector<double>& f) : _f(&f) { }
+        bool operator()(std::size_t a, std::size_t b) const { return (*_f)[a] > (*_f)[b]; }
+        const std::vector<double>* _f;
+    };
+
+    //! Select n individuals from src into dst.
+    template <typename Population, typename EA>
+    void operator()(Population& src, Population& dst, std::size_t n, EA& ea) {
+        assert(src.size() == _fitness->size());
+        const std::size_t one = 1;
+        std::size_t tn = std::max(std::min(static_cast<std::size_t>(get<TOURNAMENT_SELECTION_N>(ea)), src.size()), one);
+        std::size_t tk = std::max(std::min(static_cast<std::size_t>(get<TOURNAMENT_SELECTION_K>(ea)), tn), one);
+
+        // _idx stays a permutation of src's indices across calls, so it is
+        // only (re)built when the population size changes:
+        if(_idx.size() != src.size()) {
+            _idx.resize(src.size());
+            for(std::size_t i=0; i<_idx.size(); ++i) {
+                _idx[i] = i;
+            }
+        }
+        while(n > 0) {
+            // partial shuffle; the first tn entries of _idx are the tournament:
+            for(std::size_t i=0; i<tn; ++i) {
+                std::swap(_idx[i], _idx[i + ea.rng()(_idx.size() - i)]);
+            }
+            std::size_t k = std::min(tk, n);
+            std::partial_sort(_idx.begin(), _idx.begin()+k, _idx.begin()+tn, by_fitness(*_fitness));
+            for(std::size_t i=0; i<k; ++i) {
+                dst.insert(dst.end(), src[_idx[i]]);
+            }
+            n -= k;
+        }
+    }
+
+    const std::vector<double>* _fitness; //!< Fitness of each member of the source population.
+    std::vector<std::size_t> _idx; //!< Scratch index permutation.
+};
+
+#endif
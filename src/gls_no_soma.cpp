@@ -173,6 +173,12 @@ public:
         add_option<RECORDING_PERIOD>(this);
         
         add_option<ANALYSIS_INPUT>(this);
+        add_option<LOD_SAMPLING_STRIDE>(this);
+        add_option<LOD_SAMPLING_ADAPTIVE>(this);
+        add_option<LOD_SAMPLING_TOLERANCE>(this);
+        add_option<LOD_SAMPLING_METRIC>(this);
+        add_option<LOD_REPLAY_SNAPSHOT_PERIOD>(this);
+        add_option<LOD_SPATIAL_SNAPSHOT>(this);
         
         // gls specific options
         add_option<TASK_MUTATION_PER_SITE_P>(this);
@@ -195,6 +201,8 @@ public:
     virtual void gather_tools() {
 
         add_tool<ealib::analysis::lod_knockouts>(this);
+        add_tool<ealib::analysis::lod_late_knockouts>(this);
+        add_tool<ealib::analysis::lod_fork_check>(this);
         add_tool<ealib::analysis::lod_gls_circle_square_plot>(this);
         add_tool<ealib::analysis::lod_gls_germ_soma_mean_var>(this);
         add_tool<ealib::analysis::lod_gls_aging_res_over_time>(this);
@@ -0,0 +1,40 @@
+//
+//  group_fitness.h
+//  ealife
+//
+//  Copyright (c) 2013 Michigan State University. All rights reserved.
+//
+
+#ifndef _EALIFE_GROUP_FITNESS_H_
+#define _EALIFE_GROUP_FITNESS_H_
+
+#include <cstddef>
+#include <vector>
+
+
+/*! Evaluate every group of the metapopulation ea with f, concurrently when
+ built with OpenMP.
+
+ f(group, row) writes width values for group into row; all rows end up in
+ out, group g at out[g*width].  Each thread works on its own copy of f, so f
+ may keep scratch space (e.g., bitboards) as members.  f must only write to
+ its own group and row; anything that touches shared state (datafiles,
+ accumulators, the rng) belongs in the serial reduction that follows.
+ */
+template <typename EA, typename Fitness>
+void evaluate_groups(EA& ea, const Fitness& f, std::size_t width, std::vector<double>& out) {
+    typename EA::population_type& pop = ea.population();
+    const int n = static_cast<int>(pop.size());
+    out.resize(n * width);
+
+#pragma omp parallel
+    {
+        Fitness local(f);
+#pragma omp for schedule(dynamic, 8)
+        for(int g=0; g<n; ++g) {
+            local(*pop[g], &out[g * width]);
+        }
+    }
+}
+
+#endif
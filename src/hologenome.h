@@ -10,6 +10,7 @@
 #define _EALIFE_HOLOGENOME_H_
 #include "selfrep_not_ancestor.h"
 #include "resource_consumption.h"
+#include "fitness_tournament.h"
 
 #include <boost/accumulators/accumulators.hpp>
 #include <boost/accumulators/statistics/stats.hpp>
@@ -67,8 +68,10 @@ struct not_strength : periodic_event<METAPOP_COMPETITION_PERIOD,EA> {
         accumulator_set<double, stats<tag::mean, tag::max> > fit;
         
         // calculate "fitness":
+        _fitness.clear();
         for(typename EA::population_type::iterator i=ea.population().begin(); i!=ea.population().end(); ++i) {
-            fit(get<TASK_NOT>(**i,0));
+            _fitness.push_back(get<TASK_NOT>(**i,0.0));
+            fit(_fitness.back());
         }
         
         _df.write(ea.current_update())
@@ -79,7 +82,7 @@ struct not_strength : periodic_event<METAPOP_COMPETITION_PERIOD,EA> {
         std::size_t n=get<META_POPULATION_SIZE>(ea);
         typename EA::population_type offspring;
         recombine_n(ea.population(), offspring,
-                    selection::tournament < access::meta_data<TASK_NOT> > (n, ea.population(), ea),
+                    fitness_tournament(_fitness),
                     recombination::propagule_without_replacement(),
                     n, ea);
         
@@ -92,6 +95,7 @@ struct not_strength : periodic_event<METAPOP_COMPETITION_PERIOD,EA> {
     }
     
     datafile _df;
+    std::vector<double> _fitness; //!< Per-group fitness, for selection.
 };
 
 
@@ -117,9 +121,10 @@ struct not_nand_balance : periodic_event<METAPOP_COMPETITION_PERIOD,EA> {
         accumulator_set<double, stats<tag::mean, tag::max> > fit;
         
         // calculate "fitness":
+        _fitness.clear();
         for(typename EA::population_type::iterator i=ea.population().begin(); i!=ea.population().end(); ++i) {
             double nn = get<TASK_NOT>(**i,0) * get<TASK_NAND>(**i,0);
-            put<NOT_NAND_PROD>(nn, **i);
+            _fitness.push_back(nn);
             fit(nn);
         }
         
@@ -131,7 +136,7 @@ struct not_nand_balance : periodic_event<METAPOP_COMPETITION_PERIOD,EA> {
         std::size_t n=get<META_POPULATION_SIZE>(ea);
         typename EA::population_type offspring;
         recombine_n(ea.population(), offspring,
-                    selection::tournament < access::meta_data<NOT_NAND_PROD> > (n, ea.population(), ea),
+                    fitness_tournament(_fitness),
                     recombination::propagule_without_replacement(),
                     n, ea);
         
@@ -144,6 +149,7 @@ struct not_nand_balance : periodic_event<METAPOP_COMPETITION_PERIOD,EA> {
     }
     
     datafile _df;
+    std::vector<double> _fitness; //!< Per-group fitness, for selection.
 };
 
 
@@ -176,6 +182,7 @@ struct gender_compete: periodic_event<METAPOP_COMPETITION_PERIOD,EA> {
         int num_males = 0;
         
         // compute gender fitness. for females = nand/not; for males not/nand
+        _fitness.clear();
         for(typename EA::population_type::iterator i=ea.population().begin(); i!=ea.population().end(); ++i) {
             double score = 0.0;
             // males
@@ -197,7 +204,8 @@ struct gender_compete: periodic_event<METAPOP_COMPETITION_PERIOD,EA> {
                 female_fit(score);
             }
             fit(score);
-            put<GENDER_FIT>(score,**i);
+            // selection has always been on GENDER_FIT, a bool; keep that:
+            _fitness.push_back((score != 0.0) ? 1.0 : 0.0);
         }
         
         
@@ -229,7 +237,7 @@ struct gender_compete: periodic_event<METAPOP_COMPETITION_PERIOD,EA> {
         std::size_t n=get<META_POPULATION_SIZE>(ea);
         typename EA::population_type offspring;
         recombine_n(ea.population(), offspring,
-                    selection::tournament < access::meta_data<GENDER_FIT> > (n, ea.population(), ea),
+                    fitness_tournament(_fitness),
                     recombination::propagule_without_replacement(),
                     n, ea);
         
@@ -247,6 +255,7 @@ struct gender_compete: periodic_event<METAPOP_COMPETITION_PERIOD,EA> {
     }
     
     datafile _df;
+    std::vector<double> _fitness; //!< Per-group fitness, for selection.
 };
 
 
@@ -5,7 +5,9 @@
 #include <iostream>
 #include <sstream>
 #include <cmath>
+#include <stdexcept>
 #include <vector>
+#include <boost/functional/hash.hpp>
 #include <ea/datafile.h>
 #include <ea/line_of_descent.h>
 //#include <ea/analysis/tool.h>
@@ -14,6 +16,8 @@
 #include <ea/digital_evolution/instruction_set.h>
 #include <ea/digital_evolution/discrete_spatial_environment.h>
 
+#include "lod_replay.h"
+
 
 
 namespace ealib {
@@ -49,89 +53,210 @@ namespace ealib {
             //                using namespace ealib::analysis;
             
             line_of_descent<EA> lod = lod_load(get<ANALYSIS_INPUT>(ea), ea);
-            
-            typename line_of_descent<EA>::iterator i=lod.begin(); ++i;
+            lod_replay<EA> replay(lod, ea);
             
             datafile df("lod_knockouts.dat");
             df.add_field("lod_depth")
             .add_field("no_knockouts")
             .add_field("rx_knockedout")
-            .add_field("location_knockedout");
+            .add_field("location_knockedout")
+            .add_field("no_knockouts_stop")
+            .add_field("rx_knockedout_stop")
+            .add_field("location_knockedout_stop");
             
-            
-            int lod_depth = 0;
-            // skip def ancestor (that's what the +1 does)
-            for( ; i!=lod.end(); ++i) {
+            for (int lod_depth=0; lod_depth<replay.size(); ++lod_depth) {
                 
                 df.write(lod_depth);
                 
-                // **i is the EA, AS OF THE TIME THAT IT DIED!
-                
                 // To replay, need to create new eas for each knockout exper.
                 // setup the population (really, an ea):
-                typename EA::individual_ptr_type control_ea = ea.make_individual();
-                control_ea->rng().reset(get<RNG_SEED>(**i));
+                typename EA::individual_ptr_type control_ea = replay.subpopulation(lod_depth);
                 
-                typename EA::individual_ptr_type knockout_rx_ea = ea.make_individual();
-                knockout_rx_ea->rng().reset(get<RNG_SEED>(**i));
+                typename EA::individual_ptr_type knockout_rx_ea = replay.subpopulation(lod_depth);
                 knockout<instructions::rx_msg,instructions::nop_x>(*knockout_rx_ea);
                 
-                typename EA::individual_ptr_type knockout_location_ea = ea.make_individual();
-                knockout_location_ea->rng().reset(get<RNG_SEED>(**i));
+                typename EA::individual_ptr_type knockout_location_ea = replay.subpopulation(lod_depth);
                 knockout<instructions::get_xy,instructions::nop_x>(*knockout_location_ea);
                 
-                // setup the founder
-                typename EA::individual_type::individual_ptr_type o= (*i)->make_individual((*i)->founder().repr());
-                o->hw().initialize();
-                control_ea->append(o);
-                
-                // setup send knockout founder
-                typename EA::individual_type::individual_ptr_type ko_s = (*i)->make_individual((*i)->founder().repr());
-                ko_s->hw().initialize();
-                knockout_rx_ea->append(ko_s);
-                
-                // setup location knockout founder
-                typename EA::individual_type::individual_ptr_type ko_l = (*i)->make_individual((*i)->founder().repr());
-                ko_l->hw().initialize();
-                knockout_location_ea->append(ko_l);
-                
+                // setup the founders
+                replay.seed(*control_ea, lod_depth);
+                replay.seed(*knockout_rx_ea, lod_depth);
+                replay.seed(*knockout_location_ea, lod_depth);
                 
                 // replay! till the group amasses the right amount of resources
                 // or exceeds its window...
-                int cur_update = 0;
                 int update_max = 1000;
-                // and run till the group amasses the right amount of resources
-                while ((get<GROUP_RESOURCE_UNITS>(*control_ea,0) < get<GROUP_REP_THRESHOLD>(*control_ea)) &&
-                       (cur_update < update_max)){
-                    control_ea->update();
-                    ++cur_update;
-                }
-                df.write(cur_update);
+                replay_result control = replay.replay_to_threshold(*control_ea, update_max);
+                replay_result rx = replay.replay_to_threshold(*knockout_rx_ea, update_max);
+                replay_result location = replay.replay_to_threshold(*knockout_location_ea, update_max);
                 
-                cur_update = 0;
-                while ((get<GROUP_RESOURCE_UNITS>(*knockout_rx_ea,0) < get<GROUP_REP_THRESHOLD>(*knockout_rx_ea)) &&
-                       (cur_update < update_max)){
-                    knockout_rx_ea->update();
-                    ++cur_update;
-                }
-                df.write(cur_update);
+                df.write(control.updates)
+                .write(rx.updates)
+                .write(location.updates)
+                .write(control.stop)
+                .write(rx.stop)
+                .write(location.stop);
                 
-                cur_update = 0;
-                while ((get<GROUP_RESOURCE_UNITS>(*knockout_location_ea,0) < get<GROUP_REP_THRESHOLD>(*knockout_location_ea)) &&
-                       (cur_update < update_max)){
-                    knockout_location_ea->update();
-                    ++cur_update;
+                df.endl();
+            }
+            //            }
+            
+            //        };
+        }
+        
+        
+        /*! Forks a snapshot of a control replay and replays it with each of the
+         coordination knockouts applied from that update onward.
+         */
+        template <typename EA>
+        struct late_knockout_visitor {
+            late_knockout_visitor(lod_replay<EA>& r, int update_max)
+            : _replay(r), _update_max(update_max) {
+            }
+            
+            void operator()(int update, typename EA::individual_type& p) {
+                typename EA::individual_ptr_type knockout_rx_ea = _replay.fork(p);
+                knockout<instructions::rx_msg,instructions::nop_x>(*knockout_rx_ea);
+                
+                typename EA::individual_ptr_type knockout_location_ea = _replay.fork(p);
+                knockout<instructions::get_xy,instructions::nop_x>(*knockout_location_ea);
+                
+                replay_result rx = _replay.replay_to_threshold(*knockout_rx_ea, _update_max - update);
+                replay_result location = _replay.replay_to_threshold(*knockout_location_ea, _update_max - update);
+                
+                std::vector<int> row;
+                row.push_back(update);
+                row.push_back(update + rx.updates);
+                row.push_back(update + location.updates);
+                row.push_back(rx.stop);
+                row.push_back(location.stop);
+                rows.push_back(row);
+            }
+            
+            lod_replay<EA>& _replay;
+            int _update_max;
+            std::vector<std::vector<int> > rows; //!< update, rx time, location time, rx stop, location stop.
+        };
+        
+        
+        /*! lod_late_knockouts reruns each subpopulation along a line of descent and records how the
+         subpopulation fares when key coordination instructions are removed part-way through its
+         development, rather than from birth.
+         
+         The control replay is simulated once per depth; every LOD_REPLAY_SNAPSHOT_PERIOD updates it is
+         forked and the knockouts are applied to the copies.  Times are measured from the founder's birth,
+         and the row for update 0 matches lod_knockouts.
+         */
+        LIBEA_ANALYSIS_TOOL(lod_late_knockouts) {
+            line_of_descent<EA> lod = lod_load(get<ANALYSIS_INPUT>(ea), ea);
+            lod_replay<EA> replay(lod, ea);
+            
+            datafile df("lod_late_knockouts.dat");
+            df.add_field("lod_depth")
+            .add_field("knockout_update")
+            .add_field("no_knockouts")
+            .add_field("rx_knockedout")
+            .add_field("location_knockedout")
+            .add_field("no_knockouts_stop")
+            .add_field("rx_knockedout_stop")
+            .add_field("location_knockedout_stop");
+            
+            int update_max = 1000;
+            int period = std::max(1, get<LOD_REPLAY_SNAPSHOT_PERIOD>(ea, 100));
+            std::vector<int> snapshots;
+            for (int u=0; u<update_max; u+=period) {
+                snapshots.push_back(u);
+            }
+            
+            for (int lod_depth=0; lod_depth<replay.size(); ++lod_depth) {
+                typename EA::individual_ptr_type control_ea = replay.founder_ea(lod_depth);
+                late_knockout_visitor<EA> v(replay, update_max);
+                replay_result control = replay.replay_with_snapshots(*control_ea, snapshots, update_max, v);
+                
+                for (std::size_t k=0; k<v.rows.size(); ++k) {
+                    df.write(lod_depth)
+                    .write(v.rows[k][0])
+                    .write(control.updates)
+                    .write(v.rows[k][1])
+                    .write(v.rows[k][2])
+                    .write(control.stop)
+                    .write(v.rows[k][3])
+                    .write(v.rows[k][4])
+                    .endl();
                 }
-                df.write(cur_update);
+            }
+        }
+        
+        
+        /*! Digest of the end state of a replay: its population's size, and each
+         organism's liveness and genome.
+         */
+        template <typename Subpopulation>
+        std::size_t replay_digest(Subpopulation& p) {
+            std::size_t h=0;
+            boost::hash_combine(h, p.population().size());
+            for(typename Subpopulation::population_type::iterator j=p.population().begin(); j!=p.population().end(); ++j) {
+                boost::hash_combine(h, (**j).alive());
+                boost::hash_range(h, (**j).repr().begin(), (**j).repr().end());
+            }
+            return h;
+        }
+        
+        
+        /*! lod_fork_check checks that lod_replay::fork copies a replay
+         completely, so that lod_late_knockouts' knockouts leave the control
+         replay alone.
+         
+         For each depth, the control replay is run twice from the founder: once
+         undisturbed, and once the way lod_late_knockouts runs it, forked every
+         LOD_REPLAY_SNAPSHOT_PERIOD updates with the knockouts applied to and
+         replayed on the forks.  Anything a fork shared with its parent (the
+         organisms, their hardware, the environment, the rng or the instruction
+         set) would make the two controls diverge.  Writes lod_fork_check.dat,
+         and any depth whose controls differ in time to threshold, stop reason,
+         resources or final population is an error.
+         */
+        LIBEA_ANALYSIS_TOOL(lod_fork_check) {
+            line_of_descent<EA> lod = lod_load(get<ANALYSIS_INPUT>(ea), ea);
+            lod_replay<EA> replay(lod, ea);
+            
+            datafile df("lod_fork_check.dat");
+            df.add_field("lod_depth")
+            .add_field("undisturbed")
+            .add_field("forked")
+            .add_field("differs");
+            
+            int update_max = 1000;
+            int period = std::max(1, get<LOD_REPLAY_SNAPSHOT_PERIOD>(ea, 100));
+            std::vector<int> snapshots;
+            for (int u=0; u<update_max; u+=period) {
+                snapshots.push_back(u);
+            }
+            
+            int failed=0;
+            for (int lod_depth=0; lod_depth<replay.size(); ++lod_depth) {
+                typename EA::individual_ptr_type a = replay.founder_ea(lod_depth);
+                replay_result ra = replay.replay_to_threshold(*a, update_max);
                 
+                typename EA::individual_ptr_type b = replay.founder_ea(lod_depth);
+                late_knockout_visitor<EA> v(replay, update_max);
+                replay_result rb = replay.replay_with_snapshots(*b, snapshots, update_max, v);
                 
-                df.endl();
+                bool differs = (ra.updates != rb.updates) || (ra.stop != rb.stop)
+                || (get<GROUP_RESOURCE_UNITS>(*a,0) != get<GROUP_RESOURCE_UNITS>(*b,0))
+                || (replay_digest(*a) != replay_digest(*b));
+                failed += differs;
                 
-                ++lod_depth;
+                df.write(lod_depth)
+                .write(ra.updates)
+                .write(rb.updates)
+                .write(differs)
+                .endl();
             }
-            //            }
             
-            //        };
+            if (failed > 0) {
+                throw std::runtime_error("lod_fork_check: forking changed the control replay");
+            }
         }
     }
 }
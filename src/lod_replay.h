@@ -0,0 +1,293 @@
+//
+//  lod_replay.h
+//  ealife
+//
+//  Copyright (c) 2013 Michigan State University. All rights reserved.
+//
+
+#ifndef _EALIFE_LOD_REPLAY_H_
+#define _EALIFE_LOD_REPLAY_H_
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <ea/datafile.h>
+#include <ea/line_of_descent.h>
+#include <ea/meta_data.h>
+
+#include "resource_consumption.h"
+
+using namespace ealib;
+
+
+//! Replay every n'th depth along the line of descent.
+LIBEA_MD_DECL(LOD_SAMPLING_STRIDE, "ea.analysis.lod_sampling.stride", int);
+//! If true, bisect intervals whose metric changes by more than the tolerance.
+LIBEA_MD_DECL(LOD_SAMPLING_ADAPTIVE, "ea.analysis.lod_sampling.adaptive", bool);
+//! Largest change in the metric allowed between two neighboring samples.
+LIBEA_MD_DECL(LOD_SAMPLING_TOLERANCE, "ea.analysis.lod_sampling.tolerance", double);
+//! Name of the output column used as the adaptive sampling metric.
+LIBEA_MD_DECL(LOD_SAMPLING_METRIC, "ea.analysis.lod_sampling.metric", std::string);
+//! Period (in updates) at which snapshot replays fork their variants.
+LIBEA_MD_DECL(LOD_REPLAY_SNAPSHOT_PERIOD, "ea.analysis.lod_replay.snapshot_period", int);
+//! If true, spatial replay tools write binary snapshots instead of text.
+LIBEA_MD_DECL(LOD_SPATIAL_SNAPSHOT, "ea.analysis.lod_spatial_snapshot", bool);
+
+
+//! Why a replay stopped; written to the replay tools' *_stop columns.
+enum replay_stop {
+    REPLAY_THRESHOLD=0, //!< The group amassed GROUP_REP_THRESHOLD resources.
+    REPLAY_UPDATE_LIMIT=1, //!< The replay window ran out.
+    REPLAY_EXTINCT=2, //!< The population is empty.
+    REPLAY_INERT=3 //!< No living organism is left to execute.
+};
+
+
+//! Outcome of a replay.
+struct replay_result {
+    replay_result(int u, replay_stop s) : updates(u), stop(s) {
+    }
+
+    int updates; //!< Updates to reach the threshold, or the replay window if it was never reached.
+    replay_stop stop; //!< Why the replay stopped.
+};
+
+
+/*! Random-access view of a line of descent, used to replay the subpopulation
+ at an arbitrary depth.  Depth 0 is the first subpopulation after the default
+ ancestor, matching the lod_depth column of the replay tools.
+ */
+template <typename EA>
+struct lod_replay {
+    typedef typename line_of_descent<EA>::iterator lod_iterator;
+    typedef typename EA::individual_ptr_type subpopulation_ptr_type;
+
+    lod_replay(line_of_descent<EA>& lod, EA& ea) : _ea(ea) {
+        lod_iterator i=lod.begin(); ++i;
+        // skip def ancestor (that's what the +1 does)
+        for( ; i!=lod.end(); ++i) {
+            _depths.push_back(i);
+        }
+    }
+
+    virtual ~lod_replay() {
+    }
+
+    //! Returns the number of depths that can be replayed.
+    int size() const { return static_cast<int>(_depths.size()); }
+
+    //! Returns an empty subpopulation whose rng matches the given depth.
+    subpopulation_ptr_type subpopulation(int depth) {
+        subpopulation_ptr_type p = _ea.make_individual();
+        p->rng().reset(get<RNG_SEED>(**_depths[depth]));
+        return p;
+    }
+
+    /*! Add the founder of the given depth to p.
+
+     **i is the EA, AS OF THE TIME THAT IT DIED!  To replay, need to create a new ea.
+     */
+    void seed(typename EA::individual_type& p, int depth) {
+        lod_iterator i = _depths[depth];
+        typename EA::individual_type::individual_ptr_type o= (*i)->make_individual((*i)->founder().repr());
+        o->hw().initialize();
+        p.append(o);
+    }
+
+    //! Returns a fresh subpopulation seeded with the founder of the given depth.
+    subpopulation_ptr_type founder_ea(int depth) {
+        subpopulation_ptr_type p = subpopulation(depth);
+        seed(*p, depth);
+        return p;
+    }
+
+    /*! Run the subpopulation till it amasses the right amount of resources
+     or exceeds its window.
+
+     The replay also stops as soon as it can no longer reach the threshold:
+     when the population is empty, or when no living organism is left.
+     */
+    replay_result replay_to_threshold(typename EA::individual_type& p, int update_max) {
+        int cur_update = 0;
+        while ((get<GROUP_RESOURCE_UNITS>(p,0) < get<GROUP_REP_THRESHOLD>(p)) &&
+               (cur_update < update_max)){
+            p.update();
+            ++cur_update;
+
+            if (p.population().empty()) {
+                return replay_result(update_max, REPLAY_EXTINCT);
+            }
+            if (!any_alive(p)) {
+                return replay_result(update_max, REPLAY_INERT);
+            }
+        }
+        if (get<GROUP_RESOURCE_UNITS>(p,0) >= get<GROUP_REP_THRESHOLD>(p)) {
+            return replay_result(cur_update, REPLAY_THRESHOLD);
+        }
+        return replay_result(cur_update, REPLAY_UPDATE_LIMIT);
+    }
+
+    /*! Returns an independent copy of p (population, environment, rng and
+     instruction set), so that a variant can be applied part-way through a replay
+     without disturbing the original.  This relies on EA::copy_individual copying
+     the subpopulation deeply; the lod_fork_check tool verifies that it does.
+     */
+    subpopulation_ptr_type fork(typename EA::individual_type& p) {
+        return _ea.copy_individual(p);
+    }
+
+    /*! Replay p to the threshold, pausing at each of the given updates (in
+     increasing order) to call v(update, p).  The visitor typically forks p
+     and replays a variant from the snapshot, so the shared prefix is only
+     simulated once.  Snapshots after the threshold is reached are skipped.
+     */
+    template <typename Visitor>
+    replay_result replay_with_snapshots(typename EA::individual_type& p, const std::vector<int>& snapshots,
+                                        int update_max, Visitor& v) {
+        int cur_update = 0;
+        for(std::vector<int>::const_iterator k=snapshots.begin(); k!=snapshots.end() && (*k < update_max); ++k) {
+            replay_result r = replay_to_threshold(p, *k - cur_update);
+            cur_update += r.updates;
+            if (r.stop != REPLAY_UPDATE_LIMIT) {
+                // reached the threshold (or can never reach it) before this snapshot
+                return replay_result((r.stop == REPLAY_THRESHOLD) ? cur_update : update_max, r.stop);
+            }
+            v(cur_update, p);
+        }
+        replay_result r = replay_to_threshold(p, update_max - cur_update);
+        return replay_result((r.stop == REPLAY_THRESHOLD) ? cur_update + r.updates : update_max, r.stop);
+    }
+
+    //! Returns true if any organism in p is alive.
+    bool any_alive(typename EA::individual_type& p) {
+        for(typename EA::individual_type::population_type::iterator j=p.population().begin(); j!=p.population().end(); ++j) {
+            if ((**j).alive()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    EA& _ea;
+    std::vector<lod_iterator> _depths;
+};
+
+
+/*! Chooses which depths of a line of descent are replayed.
+
+ Replay is a functor that replays a single depth and returns its row of output
+ columns; rows are cached, so each depth is replayed at most once.  In fixed mode
+ every stride'th depth is replayed.  In adaptive mode the strided depths (plus the
+ final depth) are replayed first, and any interval whose metric column changes by
+ more than the tolerance is recursively bisected until neighboring samples agree
+ or are adjacent.
+ */
+template <typename Replay>
+class lod_sampler {
+public:
+    typedef std::vector<double> row_type;
+    typedef std::map<int,row_type> sample_type;
+
+    //! Constructor.
+    lod_sampler(Replay& r, std::size_t metric) : _replay(r), _metric(metric) {
+    }
+
+    //! Replay every stride'th depth in [0, n).
+    void fixed(int n, int stride) {
+        for(int d=0; d<n; d+=stride) {
+            sample(d);
+        }
+    }
+
+    //! Replay a coarse grid in [0, n), then bisect where the metric changes by more than tol.
+    void adaptive(int n, int stride, double tol) {
+        if(n <= 0) {
+            return;
+        }
+        std::vector<int> grid;
+        for(int d=0; d<n; d+=stride) {
+            grid.push_back(d);
+        }
+        if(grid.back() != (n-1)) {
+            grid.push_back(n-1);
+        }
+        sample(grid.front());
+        for(std::size_t k=1; k<grid.size(); ++k) {
+            bisect(grid[k-1], grid[k], tol);
+        }
+    }
+
+    //! Returns the replayed rows, ordered by depth.
+    const sample_type& samples() const { return _samples; }
+
+protected:
+    //! Replay the given depth, if it has not already been replayed.
+    const row_type& sample(int depth) {
+        typename sample_type::iterator i=_samples.find(depth);
+        if(i == _samples.end()) {
+            i = _samples.insert(std::make_pair(depth, _replay(depth))).first;
+        }
+        return i->second;
+    }
+
+    //! Recursively split [lo, hi] while its endpoints differ by more than tol.
+    void bisect(int lo, int hi, double tol) {
+        double delta = sample(hi)[_metric] - sample(lo)[_metric];
+        if(((hi - lo) < 2) || !(std::fabs(delta) > tol)) {
+            return;
+        }
+        int mid = lo + (hi - lo) / 2;
+        bisect(lo, mid, tol);
+        bisect(mid, hi, tol);
+    }
+
+    Replay& _replay; //!< Replays a single depth.
+    std::size_t _metric; //!< Index of the metric column in each row.
+    sample_type _samples; //!< Depth -> replayed row.
+};
+
+
+/*! Sample a line of descent according to the LOD_SAMPLING_* options of ea.
+
+ columns names the entries of each row returned by the replay functor; the
+ adaptive metric is selected by name from among them (default: first column).
+ */
+template <typename Replay, typename EA>
+typename lod_sampler<Replay>::sample_type lod_sample(Replay& r, int n, const std::vector<std::string>& columns,
+                                                     int default_stride, EA& ea) {
+    std::size_t metric=0;
+    if(exists<LOD_SAMPLING_METRIC>(ea)) {
+        std::vector<std::string>::const_iterator c=std::find(columns.begin(), columns.end(), get<LOD_SAMPLING_METRIC>(ea));
+        if(c == columns.end()) {
+            throw std::invalid_argument("lod_sample: unknown metric " + get<LOD_SAMPLING_METRIC>(ea));
+        }
+        metric = c - columns.begin();
+    }
+
+    int stride = std::max(1, get<LOD_SAMPLING_STRIDE>(ea, default_stride));
+    lod_sampler<Replay> s(r, metric);
+    if(get<LOD_SAMPLING_ADAPTIVE>(ea, false)) {
+        s.adaptive(n, stride, get<LOD_SAMPLING_TOLERANCE>(ea, 0.0));
+    } else {
+        s.fixed(n, stride);
+    }
+    return s.samples();
+}
+
+
+//! Write one datafile row per sampled depth: lod_depth followed by the replayed row.
+template <typename Samples>
+void write_lod_samples(datafile& df, const Samples& samples) {
+    for(typename Samples::const_iterator i=samples.begin(); i!=samples.end(); ++i) {
+        df.write(i->first);
+        for(typename Samples::mapped_type::const_iterator j=i->second.begin(); j!=i->second.end(); ++j) {
+            df.write(*j);
+        }
+        df.endl();
+    }
+}
+
+#endif
@@ -0,0 +1,196 @@
+//
+//  mutual_information.h
+//  ealife
+//
+//  Copyright (c) 2013 Michigan State University. All rights reserved.
+//
+
+#ifndef _EALIFE_MUTUAL_INFORMATION_H_
+#define _EALIFE_MUTUAL_INFORMATION_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+
+/*! Organisms x tasks matrix of task counts.
+
+ All rows live in a single contiguous block; each row is padded out to a
+ multiple of four doubles so that the per-row loops in mutual_information
+ need no remainder handling, and the branch-free sums can run over whole
+ vector registers.  The padding is always zero.
+ */
+class task_count_matrix {
+public:
+    //! Constructor.
+    task_count_matrix(std::size_t tasks) : _tasks(tasks), _stride((tasks + 3) & ~static_cast<std::size_t>(3)), _rows(0) {
+    }
+
+    //! Remove all rows, keeping the allocated storage.
+    void clear() { _rows = 0; }
+
+    //! Append a zeroed row and return a pointer to it.
+    double* add_row() {
+        ++_rows;
+        if(_data.size() < (_rows * _stride)) {
+            _data.resize(std::max(_rows * _stride, 2 * _data.size()));
+        }
+        double* r = row(_rows-1);
+        std::fill(r, r+_stride, 0.0);
+        return r;
+    }
+
+    //! Returns the number of rows (organisms).
+    std::size_t rows() const { return _rows; }
+
+    //! Returns the number of columns (tasks).
+    std::size_t tasks() const { return _tasks; }
+
+    //! Returns the distance between consecutive rows.
+    std::size_t stride() const { return _stride; }
+
+    //! Returns a pointer to row i.
+    double* row(std::size_t i) { return &_data[i*_stride]; }
+
+    //! Returns a pointer to row i.
+    const double* row(std::size_t i) const { return &_data[i*_stride]; }
+
+protected:
+    std::size_t _tasks; //!< Number of tasks.
+    std::size_t _stride; //!< Padded row length.
+    std::size_t _rows; //!< Number of rows in use.
+    std::vector<double> _data; //!< Row-major counts.
+};
+
+
+/*! Shannon mutual information between organisms and tasks.
+
+ With n active organisms (those that performed at least one task), r_i the
+ number of tasks performed by organism i, and c_ij the number of times it
+ performed task j:
+
+ pi = 1/n, pij = (c_ij / r_i) / n, pj = sum_i pij
+
+ I = sum_ij pij log(pij / (pi pj))
+   = 1/n sum_i [ (1/r_i) sum_j c_ij log c_ij - log r_i ] - sum_j pj log pj
+
+ The second form needs a log only per organism and per task; the c log c
+ terms are looked up in a table, since task counts are small integers.  The
+ table is grown to the matrix's largest count before the rows are visited, so
+ the per-row loops index it directly, without branches; a matrix with counts
+ the table cannot hold (non-integral, or table_size or more) is handled
+ without it.  The table is kept between calls, so one instance should be
+ reused across an entire line of descent.
+ */
+class mutual_information {
+public:
+    //! Largest count whose c log c is tabulated.
+    static const std::size_t table_size = 1 << 16;
+
+    //! Constructor.
+    mutual_information() : _active(0), _mi(0.0) {
+    }
+
+    //! Compute the mutual information of m.
+    void operator()(const task_count_matrix& m) {
+        const std::size_t stride = m.stride();
+        _pj.assign(stride, 0.0);
+        _active = 0;
+        double row_terms = 0.0;
+        const bool tabulated = tabulate(m);
+
+        for(std::size_t i=0; i<m.rows(); ++i) {
+            const double* c = m.row(i);
+            double r = 0.0;
+            for(std::size_t j=0; j<stride; ++j) {
+                r += c[j];
+            }
+            if(r <= 0.0) {
+                continue;
+            }
+            ++_active;
+
+            double clogc = 0.0;
+            double inv_r = 1.0 / r;
+            for(std::size_t j=0; j<stride; ++j) {
+                _pj[j] += c[j] * inv_r;
+            }
+            if(tabulated) {
+                for(std::size_t j=0; j<stride; ++j) {
+                    clogc += _xlogx[static_cast<std::size_t>(c[j])];
+                }
+            } else {
+                for(std::size_t j=0; j<stride; ++j) {
+                    clogc += xlogx(c[j]);
+                }
+            }
+            row_terms += clogc * inv_r - std::log(r);
+        }
+
+        _mi = 0.0;
+        if(_active > 1) {
+            double n = static_cast<double>(_active);
+            double pj_terms = 0.0;
+            for(std::size_t j=0; j<stride; ++j) {
+                double pj = _pj[j] / n;
+                if(pj > 0.0) {
+                    pj_terms += pj * std::log(pj);
+                }
+            }
+            _mi = row_terms / n - pj_terms;
+        }
+    }
+
+    //! Returns the number of active organisms in the last matrix.
+    std::size_t active() const { return _active; }
+
+    //! Returns the mutual information of the last matrix.
+    double mi() const { return _mi; }
+
+    //! Returns the mutual information of the last matrix, normalized by log(active).
+    double mi_norm() const { return _mi / std::log(static_cast<double>(_active)); }
+
+protected:
+    /*! Grow the table to cover every count in m.  Returns false (leaving the
+     table as it is) if some count is negative, non-integral or too large.
+     */
+    bool tabulate(const task_count_matrix& m) {
+        if(m.rows() == 0) {
+            return true;
+        }
+        const double* c = m.row(0);
+        const std::size_t n = m.rows() * m.stride();
+        double cmax = 0.0;
+        for(std::size_t i=0; i<n; ++i) {
+            if((c[i] < 0.0) || (c[i] != std::floor(c[i]))) {
+                return false;
+            }
+            cmax = std::max(cmax, c[i]);
+        }
+        if(cmax >= static_cast<double>(table_size)) {
+            return false;
+        }
+        std::size_t k = static_cast<std::size_t>(cmax);
+        if(k >= _xlogx.size()) {
+            std::size_t i=_xlogx.size();
+            _xlogx.resize(std::min(static_cast<std::size_t>(table_size), std::max(2*k, static_cast<std::size_t>(64))));
+            for( ; i<_xlogx.size(); ++i) {
+                _xlogx[i] = (i == 0) ? 0.0 : i * std::log(static_cast<double>(i));
+            }
+        }
+        return true;
+    }
+
+    //! Returns x log x, with 0 log 0 = 0.
+    static double xlogx(double x) {
+        return (x > 0.0) ? x * std::log(x) : 0.0;
+    }
+
+    std::size_t _active; //!< Number of active organisms.
+    double _mi; //!< Mutual information.
+    std::vector<double> _pj; //!< Column sums of the normalized rows.
+    std::vector<double> _xlogx; //!< Tabulated k log k.
+};
+
+#endif
@@ -84,6 +84,7 @@ struct ts_configuration : public abstract_configuration<EA> {
         add_event<task_resource_consumption>(this,ea);
         add_event<task_switching_cost>(this, ea);
         add_event<ts_birth_event>(this,ea);
+        add_event<ts_death_event>(this,ea);
     }
     
     //! Initialize! Things are live and are mostly setup. All the objects are there, but they
@@ -188,8 +189,8 @@ public:
         // ts specific options
         add_option<GROUP_REP_THRESHOLD>(this);
         add_option<TASK_SWITCHING_COST>(this);
-        add_option<LAST_TASK>(this);
         add_option<NUM_SWITCHES>(this);
+        add_option<TS_TRACKING_PERIOD>(this);
         add_option<GERM_MUTATION_PER_SITE_P>(this);
         
         // initial amount (unit), inflow (unit), outflow (percentage), percent consumed
@@ -21,6 +21,8 @@
 #include "repro_not_ancestor.h"
 #include "resource_consumption.h"
 #include "configurable_mutation.h"
+#include "subpopulation_founder.h"
+#include "task_switch_totals.h"
 
 
 #include <ea/digital_evolution.h>
@@ -108,6 +110,58 @@ DIGEVO_INSTRUCTION_DECL(if_soma){
 }
 
 
+/*! Builds an offspring group (propagule) from germ organisms of a parent group.
+ 
+ The offspring's population is reserved up front.  Each germ contributes its
+ genome, truncated to its original size and mutated once, without copying
+ the germ's hardware or metadata; that genome is then placed as many times
+ as requested, so clonal copies share a single mutation.  Cells inherit the
+ germ's epigenetic info, and are added to the group's task-switch totals (see
+ ts_count_totals) as they are placed.
+ */
+template <typename EA>
+class propagule_builder {
+public:
+    typedef typename EA::individual_ptr_type group_ptr_type;
+    typedef typename EA::individual_type::individual_type organism_type;
+    typedef typename EA::individual_type::individual_ptr_type organism_ptr_type;
+    
+    //! Constructor; starts an empty offspring group with room for capacity cells.
+    propagule_builder(EA& ea, std::size_t capacity) : _group(ea.make_individual()), _m(get<GERM_MUTATION_PER_SITE_P>(ea)), _size(0) {
+        _group->population().reserve(capacity);
+    }
+    
+    //! Add copies cells built from germ g.
+    void add(organism_type& g, int copies=1) {
+        organism_type org(founder_genome(g));
+        mutate(org, _m, *_group);
+        
+        bool epigenetic = exists<EPIGENETIC_INFO>(g);
+        for (int k=0; k<copies; ++k) {
+            organism_ptr_type o=_group->make_individual(org.repr());
+            if (epigenetic) {
+                put<EPIGENETIC_INFO>(get<EPIGENETIC_INFO>(g), *o);
+            }
+            _group->append(o);
+            get<TS_LIVE_ORGS>(*_group, 0) += 1;
+            get<TS_SWITCH_TOTAL>(*_group, 0) += get<NUM_SWITCHES>(*o, 0);
+            ++_size;
+        }
+    }
+    
+    //! Returns the number of cells added so far.
+    int size() const { return _size; }
+    
+    //! Returns the offspring group.
+    group_ptr_type group() { return _group; }
+    
+protected:
+    group_ptr_type _group; //!< Offspring group.
+    configurable_per_site _m; //!< Germ mutation.
+    int _size; //!< Number of cells added.
+};
+
+
 //! Performs group replication.
 template <typename EA>
 struct ps_size_propagule2 : end_of_update_event<EA> {
@@ -170,36 +224,19 @@ struct ps_size_propagule2 : end_of_update_event<EA> {
             }
             
             get<NUM_GROUP_REPLICATIONS>(ea,0) ++;
-            // setup the population (really, an ea):
-            typename EA::individual_ptr_type p = ea.make_individual();
-            
-            
-            int p_size = 0;
-            
-            typename EA::individual_type::individual_type org;
+            // build the propagule from the (shuffled) germ:
+            propagule_builder<EA> prop(ea, static_cast<std::size_t>(desired_prop_size));
+            typename EA::individual_ptr_type p = prop.group();
             
             for(typename EA::individual_type::population_type::iterator j=i->population().begin(); j!=i->population().end(); ++j) {
                 typename EA::individual_type::individual_type& prop_org=**j;
                 
                 if (get<GERM_STATUS>(prop_org,true)) {
-                    org = prop_org;
-                    org.repr().resize(org.hw().original_size());
-                    org.hw().initialize();
-                    
-                    // mutate it:
-                    configurable_per_site m(get<GERM_MUTATION_PER_SITE_P>(ea));
-                    mutate(org,m,*p);
-                    typename EA::individual_type::individual_ptr_type o=p->make_individual(org.repr());
-                    if(exists<EPIGENETIC_INFO>(org)) {
-                        put<EPIGENETIC_INFO>(get<EPIGENETIC_INFO>(org),*o);
-                    }
-                    
-                    p->append(o);
-                    ++p_size;
+                    prop.add(prop_org);
                 }
                 
-                if (p_size >= desired_prop_size) {
-                    put<ACTUAL_PROP_SIZE>(p_size, *p);
+                if (prop.size() >= desired_prop_size) {
+                    put<ACTUAL_PROP_SIZE>(prop.size(), *p);
                     break;
                 }
             }
@@ -305,36 +342,19 @@ struct ps_size_propagule : end_of_update_event<EA> {
             }
             
             get<NUM_GROUP_REPLICATIONS>(ea,0) ++;
-            // setup the population (really, an ea):
-            typename EA::individual_ptr_type p = ea.make_individual();
-            
-            
-            int p_size = 0;
-            
-            typename EA::individual_type::individual_type org;
+            // build the propagule from the (shuffled) germ:
+            propagule_builder<EA> prop(ea, static_cast<std::size_t>(desired_prop_size));
+            typename EA::individual_ptr_type p = prop.group();
             
             for(typename EA::individual_type::population_type::iterator j=i->population().begin(); j!=i->population().end(); ++j) {
                 typename EA::individual_type::individual_type& prop_org=**j;
                 
                 if (get<GERM_STATUS>(prop_org,true)) {
-                    org = prop_org;
-                    org.repr().resize(org.hw().original_size());
-                    org.hw().initialize();
-                
-                    // mutate it:
-                    configurable_per_site m(get<GERM_MUTATION_PER_SITE_P>(ea));
-                    mutate(org,m,*p);
-                    typename EA::individual_type::individual_ptr_type o=p->make_individual(org.repr());
-                    if(exists<EPIGENETIC_INFO>(org)) {
-                        put<EPIGENETIC_INFO>(get<EPIGENETIC_INFO>(org),*o);
-                    }
-                
-                    p->append(o);
-                    ++p_size;
+                    prop.add(prop_org);
                 }
                 
-                if (p_size >= desired_prop_size) {
-                    put<ACTUAL_PROP_SIZE>(p_size, *p);
+                if (prop.size() >= desired_prop_size) {
+                    put<ACTUAL_PROP_SIZE>(prop.size(), *p);
                     break;
                 }
             }
@@ -407,45 +427,17 @@ struct ts_replication_propagule : end_of_update_event<EA> {
                 get<NUM_GROUP_REPLICATIONS>(ea,0) ++;
 
                 
-                // setup the population (really, an ea):
-                typename EA::individual_ptr_type p = ea.make_individual();
-
+                // build the propagule: one germ copied PROP_SIZE times if clonal,
+                // otherwise PROP_SIZE different germs.
+                int copies = (get<PROP_COMPOSITION>(*i) == 0) ? static_cast<int>(ceil(get<PROP_SIZE>(*i))) : 1;
+                propagule_builder<EA> prop(ea, num_parents * copies);
+                typename EA::individual_ptr_type p = prop.group();
+                
                 std::random_shuffle(i->population().begin(), i->population().end(), ea.rng());
-
-                int p_size = 0;
                 
-                typename EA::individual_type::individual_type org;
-
+                int p_size = 0;
                 for(typename EA::individual_type::population_type::iterator j=i->population().begin(); j!=i->population().end(); ++j) {
-                    typename EA::individual_type::individual_type& prop_org=**j;
-                    org = prop_org;
-                    org.repr().resize(org.hw().original_size());
-                    org.hw().initialize();
-                    
-                    // mutate it:
-                    configurable_per_site m(get<GERM_MUTATION_PER_SITE_P>(ea));
-                    mutate(org,m,*p);
-                    
-                    if (get<PROP_COMPOSITION>(*i) == 0) {
-                        for (int k=0; k<get<PROP_SIZE>(*i); ++k) {
-                            // and fill up the offspring population with copies of the germ:
-                            typename EA::individual_type::individual_ptr_type o=p->make_individual(org.repr());
-                            if(exists<EPIGENETIC_INFO>(org)) {
-                                put<EPIGENETIC_INFO>(get<EPIGENETIC_INFO>(org),*o);
-                            }
-                            
-                            p->append(o);
-                        }
-                    } else {
-                        // and fill up the offspring population with copies of the germ:
-                        typename EA::individual_type::individual_ptr_type o=p->make_individual(org.repr());
-                        if(exists<EPIGENETIC_INFO>(org)) {
-                            put<EPIGENETIC_INFO>(get<EPIGENETIC_INFO>(org),*o);
-                        }
-                        p->append(o);
-                        
-                    }
-                    
+                    prop.add(**j, copies);
                     ++p_size;
                     if (p_size >= num_parents) break;
                 }
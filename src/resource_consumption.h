@@ -19,6 +19,8 @@
 #include <ea/selection/random.h>
 #include <ea/mutation.h>
 
+#include "task_id.h"
+
 using namespace ealib;
 
 
@@ -36,6 +38,61 @@ LIBEA_MD_DECL(TASK_NOR, "ea.nor", double);
 LIBEA_MD_DECL(TASK_XOR, "ea.xor", double);
 LIBEA_MD_DECL(TASK_EQUALS, "ea.equals", double);
 
+/*! The nine logic tasks counted by task_resource_consumption, indexed in the
+ column order of tasks.dat.
+ */
+namespace logic_tasks {
+    
+    const int num_tasks = 9;
+    
+    //! Returns the name of logic task k.
+    inline const char* name(int k) {
+        static const char* names[num_tasks] = { "not", "nand", "and", "ornot", "or", "andnot", "nor", "xor", "equals" };
+        return names[k];
+    }
+    
+    //! Returns the index of the task with interned id t, or -1 if it is not a logic task.
+    inline int index(int t) {
+        static std::vector<int> idx;
+        if(idx.empty()) {
+            for(int k=0; k<num_tasks; ++k) {
+                int i = task_ids::id(name(k));
+                if(static_cast<int>(idx.size()) <= i) {
+                    idx.resize(i+1, -1);
+                }
+                idx[i] = k;
+            }
+        }
+        return ((t >= 0) && (t < static_cast<int>(idx.size()))) ? idx[t] : -1;
+    }
+    
+    //! Returns the index of the logic task named n, or -1.
+    inline int index(const std::string& n) {
+        for(int k=0; k<num_tasks; ++k) {
+            if(n == name(k)) {
+                return k;
+            }
+        }
+        return -1;
+    }
+    
+    //! Returns the TASK_* counter of logic task k held by md.
+    template <typename MetaData>
+    double& count(int k, MetaData& md) {
+        switch(k) {
+            case 0: return get<TASK_NOT>(md, 0.0);
+            case 1: return get<TASK_NAND>(md, 0.0);
+            case 2: return get<TASK_AND>(md, 0.0);
+            case 3: return get<TASK_ORNOT>(md, 0.0);
+            case 4: return get<TASK_OR>(md, 0.0);
+            case 5: return get<TASK_ANDNOT>(md, 0.0);
+            case 6: return get<TASK_NOR>(md, 0.0);
+            case 7: return get<TASK_XOR>(md, 0.0);
+            default: return get<TASK_EQUALS>(md, 0.0);
+        }
+    }
+}
+
 /*! Donate an organism's resources to the group. 
  */
 
@@ -60,16 +117,11 @@ struct task_resource_consumption : reaction_event<EA> {
                             double r,
                             EA& ea) {
         get<SAVED_RESOURCES>(ind, 0.0) += r;
-        std::string t = task->name();
-        if (t == "not") { get<TASK_NOT>(ea,0.0) += 1.0; get<TASK_NOT>(ind,0.0) += 1.0; }
-        else if (t == "nand") { get<TASK_NAND>(ea,0.0) += 1.0; get<TASK_NAND>(ind,0.0) += 1.0; }
-        else if (t == "and") { get<TASK_AND>(ea,0.0) += 1.0; get<TASK_AND>(ind,0.0) += 1.0; }
-        else if (t == "ornot") { get<TASK_ORNOT>(ea,0.0) += 1.0; get<TASK_ORNOT>(ind,0.0) += 1.0; }
-        else if (t == "or") { get<TASK_OR>(ea,0.0) += 1.0; get<TASK_OR>(ind,0.0) += 1.0; }
-        else if (t == "andnot") { get<TASK_ANDNOT>(ea,0.0) += 1.0; get<TASK_ANDNOT>(ind,0.0) += 1.0; }
-        else if (t == "nor") { get<TASK_NOR>(ea,0.0) += 1.0; get<TASK_NOR>(ind,0.0) += 1.0; }
-        else if (t == "xor") { get<TASK_XOR>(ea,0.0) += 1.0; get<TASK_XOR>(ind,0.0) += 1.0; }
-        else if (t == "equals") { get<TASK_EQUALS>(ea,0.0) += 1.0; get<TASK_EQUALS>(ind,0.0) += 1.0; }
+        int k = logic_tasks::index(task_ids::id(*task));
+        if (k >= 0) {
+            logic_tasks::count(k, ea) += 1.0;
+            logic_tasks::count(k, ind) += 1.0;
+        }
         
     }
 };
@@ -18,6 +18,10 @@
 #include <ea/metapopulation.h>
 #include <ea/selection/random.h>
 #include <ea/mutation.h>
+#include <cmath>
+#include <limits>
+
+#include "task_switch_totals.h"
 
 using namespace ealib;
 
@@ -33,7 +37,149 @@ using namespace ealib;
 LIBEA_MD_DECL(TASK_NOT_REWARD, "ea.res_pheno.not_reward", double);
 LIBEA_MD_DECL(TASK_EXP_BASE, "ea.res_pheno.task_exp_base", double);
 
+// neighbors that have performed not, kept per organism; see not_neighbors:
+LIBEA_MD_DECL(NOT_NEIGHBORS, "ea.res_pheno.not_neighbors", int);
+LIBEA_MD_DECL(NOT_NEIGHBORS_NS, "ea.res_pheno.not_neighbors_ns", int);
+LIBEA_MD_DECL(NOT_NEIGHBOR, "ea.res_pheno.not_neighbor", int); // 1 once counted by its neighbors
+
 
+/*! exp_base^k for k = 0..8 (the possible neighbor counts), recomputed only
+ when exp_base changes.
+ */
+class neighbor_reward_table {
+public:
+    //! Constructor.
+    neighbor_reward_table() : _base(std::numeric_limits<double>::quiet_NaN()) {
+    }
+    
+    //! Returns exp_base^k.
+    double operator()(double exp_base, int k) {
+        if (exp_base != _base) {
+            _base = exp_base;
+            for (int i=0; i<=8; ++i) {
+                _pow[i] = pow(exp_base, static_cast<double>(i));
+            }
+        }
+        return _pow[k];
+    }
+    
+protected:
+    double _base; //!< Base of the tabulated powers.
+    double _pow[9]; //!< _base^k.
+};
+
+
+/*! Per-organism counts of the neighbors (in the eight directions of the unit
+ circle; see stripes) whose living occupant has performed not, so that spots
+ and stripes do not walk the neighborhood on every reaction.
+
+ NOT_NEIGHBORS counts all eight directions, NOT_NEIGHBORS_NS only north (2)
+ and south (6).  An organism's counts are taken from its neighborhood the
+ first time they are needed (-1 means not yet), and kept up to date after
+ that: an organism adds itself to its neighbors' counts when it first
+ performs not (setting NOT_NEIGHBOR), and removes itself when it dies
+ (not_neighbors_death).  Newborns start uncounted and not counted
+ (not_neighbors_birth), whatever they inherited.
+ */
+namespace not_neighbors {
+    
+    //! Returns true if the occupant of location n is alive and has performed not.
+    template <typename EnvIterator>
+    bool has_not(EnvIterator n) {
+        return n->occupied() && n->inhabitant()->alive() && get<NOT_NEIGHBOR>(*(n->inhabitant()),0);
+    }
+    
+    //! Count ind's neighbors that have performed not, if that has not been done yet.
+    template <typename EA>
+    void count(typename EA::individual_type& ind, EA& ea) {
+        if (get<NOT_NEIGHBORS>(ind, -1) >= 0) {
+            return;
+        }
+        int all=0, ns=0;
+        for (int i=0; i<=7; ++i) {
+            if (has_not(ea.env().direction_neighbor(ind, i, ea))) {
+                ++all;
+                ns += ((i == 2) || (i == 6));
+            }
+        }
+        put<NOT_NEIGHBORS>(all, ind);
+        put<NOT_NEIGHBORS_NS>(ns, ind);
+    }
+    
+    /*! Add d to the counts of ind's neighbors.  Neighborhoods are symmetric:
+     ind is north or south of its neighbor exactly when that neighbor is south
+     or north of ind.  Neighbors that are not counted yet will see ind when
+     they are.
+     */
+    template <typename EA>
+    void add(typename EA::individual_type& ind, int d, EA& ea) {
+        for (int i=0; i<=7; ++i) {
+            typename EA::environment_type::iterator n = ea.env().direction_neighbor(ind, i, ea);
+            if (!n->occupied()) {
+                continue;
+            }
+            typename EA::individual_type& o = *(n->inhabitant());
+            if (get<NOT_NEIGHBORS>(o, -1) >= 0) {
+                get<NOT_NEIGHBORS>(o) += d;
+                if ((i == 2) || (i == 6)) {
+                    get<NOT_NEIGHBORS_NS>(o) += d;
+                }
+            }
+        }
+    }
+    
+    //! Called by spots and stripes when ind performs not: adds ind to its neighbors' counts if this is its first not.
+    template <typename EA>
+    void performing_not(typename EA::individual_type& ind, EA& ea) {
+        if (!get<NOT_NEIGHBOR>(ind, 0)) {
+            put<NOT_NEIGHBOR>(1, ind);
+            add(ind, 1, ea);
+        }
+    }
+}
+
+
+//! Newborns start with their neighbors uncounted; see not_neighbors.
+template <typename EA>
+struct not_neighbors_birth : birth_event<EA> {
+    not_neighbors_birth(EA& ea) : birth_event<EA>(ea) {
+    }
+    
+    virtual ~not_neighbors_birth() {
+    }
+    
+    virtual void operator()(typename EA::individual_type& offspring, // individual offspring
+                            typename EA::individual_type& parent, // individual parent
+                            EA& ea) {
+        put<NOT_NEIGHBORS>(-1, offspring);
+        put<NOT_NEIGHBORS_NS>(0, offspring);
+        put<NOT_NEIGHBOR>(0, offspring);
+    }
+};
+
+
+//! Removes a dying organism that has performed not from its neighbors' counts; see not_neighbors.
+template <typename EA>
+struct not_neighbors_death : death_event<EA> {
+    not_neighbors_death(EA& ea) : death_event<EA>(ea) {
+    }
+    
+    virtual ~not_neighbors_death() {
+    }
+    
+    virtual void operator()(typename EA::individual_type& ind, EA& ea) {
+        if (get<NOT_NEIGHBOR>(ind, 0)) {
+            put<NOT_NEIGHBOR>(0, ind);
+            not_neighbors::add(ind, -1, ea);
+        }
+    }
+};
+
+
+/*! Rewards not by how many of an organism's neighbors have not performed it.
+
+ Register not_neighbors_birth and not_neighbors_death alongside.
+ */
 template <typename EA>
 struct spots : reaction_event<EA> {
     spots(EA& ea) : reaction_event <EA>(ea) {
@@ -52,21 +198,14 @@ struct spots : reaction_event<EA> {
 
         
         // check neigbhors
-        double potential_neighbors = 8.0;
-        double neighbor_task_count = 0.0;
+        int potential_neighbors = 8;
         double exp_base = get<TASK_EXP_BASE>(ea);
         
-        // spin around the circle (find even locations), check if they performed NOT
-        for (int i=0; i<=7; i+=1) {
-            typedef typename EA::environment_type::iterator env_it;
-            env_it n = ea.env().direction_neighbor(ind, i, ea);
-            if(n->occupied() && get<TASK_NOT>(*(n->inhabitant()),0.0)) {
-                    neighbor_task_count++;
-            }
-        }
-      
+        not_neighbors::count(ind, ea);
+        int neighbor_task_count = get<NOT_NEIGHBORS>(ind);
         
-        double res = pow(exp_base,(potential_neighbors-neighbor_task_count));
+        double res = _reward(exp_base, potential_neighbors-neighbor_task_count);
+        not_neighbors::performing_not(ind, ea);
         
         get<SAVED_RESOURCES>(ind, 0.0) += res;
         get<TASK_NOT_REWARD>(ind, 0.0) += res;
@@ -75,8 +214,15 @@ struct spots : reaction_event<EA> {
         get<TASK_NOT>(ind, 0.0) += 1.0;
         
     }
+    
+    neighbor_reward_table _reward; //!< exp_base^k.
 };
 
+/*! Rewards not by how many of an organism's north and south neighbors have
+ performed it, and how many of its other neighbors have not.
+
+ Register not_neighbors_birth and not_neighbors_death alongside.
+ */
 template <typename EA>
 struct stripes : reaction_event<EA> {
     stripes(EA& ea) : reaction_event <EA>(ea) {
@@ -102,30 +248,17 @@ struct stripes : reaction_event<EA> {
          5  |  6  |  7
          */
 
-        double neighbors_right_action = 0.0;
         double exp_base = get<TASK_EXP_BASE>(ea);
-
-        typedef typename EA::environment_type::iterator env_it;
         
-        // north
-        env_it n = ea.env().direction_neighbor(ind, 2, ea);
-        if (n->occupied() && get<TASK_NOT>(*(n->inhabitant()),0.0)) { neighbors_right_action++; }
+        not_neighbors::count(ind, ea);
         
-        // south
-        env_it n2 = ea.env().direction_neighbor(ind, 6, ea);
-        if (n2->occupied() && get<TASK_NOT>(*(n2->inhabitant()),0.0)) { neighbors_right_action++; }
-        
-        // spin around the remainder of the neighbors...
-        for (int i=0; i<=7; i+=1) {
-            if (i==2 || i ==6) { continue; }
-
-            env_it n3 = ea.env().direction_neighbor(ind, i, ea);
-            if(!(n3->occupied() && get<TASK_NOT>(*(n3->inhabitant()),0.0))) {
-                neighbors_right_action++;
-            }
-        }
+        // north and south that have performed not, plus the remainder of the
+        // neighbors that have not:
+        int ns = get<NOT_NEIGHBORS_NS>(ind);
+        int neighbors_right_action = ns + (6 - (get<NOT_NEIGHBORS>(ind) - ns));
         
-        double res = pow(exp_base, neighbors_right_action);
+        double res = _reward(exp_base, neighbors_right_action);
+        not_neighbors::performing_not(ind, ea);
 
         
         get<SAVED_RESOURCES>(ind, 0.0) += res;
@@ -135,6 +268,8 @@ struct stripes : reaction_event<EA> {
         get<TASK_NOT>(ind, 0.0) += 1.0;
         
     }
+    
+    neighbor_reward_table _reward; //!< exp_base^k.
 };
 
 
@@ -145,7 +280,7 @@ struct stripes : reaction_event<EA> {
 
 template <typename EA>
 struct reward_tracking : end_of_update_event<EA> {
-    reward_tracking(EA& ea) : end_of_update_event<EA>(ea), _df("ps.dat") {
+    reward_tracking(EA& ea) : end_of_update_event<EA>(ea), _df("ps.dat"), _counted(false) {
         _df.add_field("update")
         .add_field("sub_pop_size")
         .add_field("pop_size")
@@ -157,8 +292,22 @@ struct reward_tracking : end_of_update_event<EA> {
     virtual ~reward_tracking() {
     }
     
-    //! Track how many task-switches are being performed!
+    /*! Track the mean reward per not.
+     
+     spots and stripes keep each group's TASK_NOT_REWARD and TASK_NOT as
+     running totals, and ts_birth_event and ts_death_event its live organisms
+     (TS_LIVE_ORGS), so a row only needs one pass over the groups.  As in
+     task_switch_tracking, the first call counts every group from its
+     organisms, which covers the initial population.
+     */
     virtual void operator()(EA& ea) {
+        if (!_counted) {
+            for(typename EA::iterator i=ea.begin(); i!=ea.end(); ++i) {
+                ts_count_totals(i->population(), *i);
+            }
+            _counted = true;
+        }
+        
         if ((ea.current_update() % 100) == 0) {
             double org = 0;
             
@@ -168,17 +317,9 @@ struct reward_tracking : end_of_update_event<EA> {
             
             for(typename EA::iterator i=ea.begin(); i!=ea.end(); ++i) {
                 ++sub_pop_size;
-                for(typename EA::subpopulation_type::iterator j=i->population().begin(); j!=i->population().end(); ++j){
-                    
-                    typename EA::subpopulation_type::individual_type& ind=**j;
-                    rew += get<TASK_NOT_REWARD>(*i,0.0);
-                    not_count += get<TASK_NOT>(*i,0.0);
-
-
-                    if (ind.alive()) {
-                        ++org;
-                    }
-                }
+                org += get<TS_LIVE_ORGS>(*i, 0);
+                rew += get<TASK_NOT_REWARD>(*i,0.0);
+                not_count += get<TASK_NOT>(*i,0.0);
             }
             if (not_count) {
                 rew /= not_count; 
@@ -192,7 +333,7 @@ struct reward_tracking : end_of_update_event<EA> {
         
     }
     datafile _df;
-    
+    bool _counted; //!< True once every group's totals have been counted.
 };
 
 
@@ -19,6 +19,9 @@
 #include <ea/digital_evolution/instruction_set.h>
 #include <ea/digital_evolution/discrete_spatial_environment.h>
 
+#include "lod_replay.h"
+#include "mutual_information.h"
+
 
 
 namespace ealib {
@@ -29,6 +32,52 @@ namespace ealib {
         
         
         
+        /*! Replays a single depth of a LoD for lod_shannon_tasks_orgs.
+         */
+        template <typename EA>
+        struct shannon_tasks_orgs_replay : lod_replay<EA> {
+            shannon_tasks_orgs_replay(line_of_descent<EA>& lod, EA& ea) : lod_replay<EA>(lod, ea), _counts(9) {
+            }
+            
+            //! Replay a single depth; returns shannon, shannon_norm, active_pop, total_pop, replay_stop.
+            std::vector<double> operator()(int lod_depth) {
+                typename EA::individual_ptr_type p = this->founder_ea(lod_depth);
+                
+                // replay! till the group amasses the right amount of resources
+                // or exceeds its window...
+                replay_result r = this->replay_to_threshold(*p, 10000);
+                
+                // cycle through orgs and create matrix for shannon mutual information.
+                _counts.clear();
+                for(typename EA::individual_type::population_type::iterator j=(p)->population().begin(); j!=(p)->population().end(); ++j) {
+                    typename EA::individual_type::individual_type& org=**j;
+                    double* porg = _counts.add_row();
+                    porg[0] = get<TASK_NOT>(org,0.0);
+                    porg[1] = get<TASK_NAND>(org,0.0);
+                    porg[2] = get<TASK_AND>(org,0.0);
+                    porg[3] = get<TASK_ORNOT>(org,0.0);
+                    porg[4] = get<TASK_OR>(org,0.0);
+                    porg[5] = get<TASK_ANDNOT>(org,0.0);
+                    porg[6] = get<TASK_NOR>(org,0.0);
+                    porg[7] = get<TASK_XOR>(org,0.0);
+                    porg[8] = get<TASK_EQUALS>(org,0.0);
+                }
+                _mi(_counts);
+                
+                std::vector<double> row;
+                row.push_back(_mi.mi());
+                row.push_back(_mi.mi_norm());
+                row.push_back(_mi.active());
+                row.push_back(_counts.rows());
+                row.push_back(r.stop);
+                return row;
+            }
+            
+            task_count_matrix _counts; //!< Organisms x tasks counts, reused across depths.
+            mutual_information _mi; //!< Mutual information kernel, reused across depths.
+        };
+        
+        
         /*! lod_shannon_tasks_orgs 
          
          This particular measurement is the same one we used in the PNAS paper. It does not take into account how much time
@@ -40,6 +89,7 @@ namespace ealib {
          pj = # of times task done / # tasks done total 
          pij = (# times org did task j / # tasks done by org) / # active orgs
          
+         By default every 10th depth is replayed; see lod_replay.h for adaptive sampling.
          */
         template <typename EA>
         struct lod_shannon_tasks_orgs : public ealib::analysis::unary_function<EA> {
@@ -50,132 +100,22 @@ namespace ealib {
                 using namespace ealib::analysis;
                 
                 line_of_descent<EA> lod = lod_load(get<ANALYSIS_INPUT>(ea), ea);
+                shannon_tasks_orgs_replay<EA> replay(lod, ea);
                 
-                typename line_of_descent<EA>::iterator i=lod.begin(); ++i;
-                
+                std::vector<std::string> columns;
+                columns.push_back("shannon");
+                columns.push_back("shannon_norm");
+                columns.push_back("active_pop");
+                columns.push_back("total_pop");
+                columns.push_back("replay_stop");
                 
                 datafile df("lod_shannon_tasks_orgs.dat");
-                df.add_field("lod_depth")
-                .add_field("shannon")
-                .add_field("shannon_norm")
-                .add_field("active_pop")
-                .add_field("total_pop");
-                
-
-                
-                int lod_depth = 0;
-                // skip def ancestor (that's what the +1 does)
-                for( ; i!=lod.end(); ++i) {
-                    
-                    if ((lod_depth % 10) != 0) {
-                        lod_depth++;
-                        continue;
-                    }
-                    
-                    // **i is the EA, AS OF THE TIME THAT IT DIED!
-                    
-                    // To replay, need to create a new ea
-                    // setup the population (really, an ea):
-                    typename EA::individual_ptr_type p = ea.make_individual();
-                    p->rng().reset(get<RNG_SEED>(**i));
-                    
-                    // setup the founder
-                    typename EA::individual_type::individual_ptr_type o= (*i)->make_individual((*i)->founder().repr());
-                    o->hw().initialize();
-                    p->append(o);
-                    
-
-                    // replay! till the group amasses the right amount of resources
-                    // or exceeds its window...
-                    int cur_update = 0;
-                    int update_max = 10000;
-                    // and run till the group amasses the right amount of resources
-                    while ((get<GROUP_RESOURCE_UNITS>(*p,0) < get<GROUP_REP_THRESHOLD>(*p)) &&
-                           (cur_update < update_max)){
-                        (p)->update();
-                        ++cur_update;
-                    }
-                    
-                    df.write(lod_depth);
-                    
-                    std::vector< std::vector<double> > pij;
-                    std::vector<double> pj (9);
-                    double pop_count = 0;
-                    double active_pop = 0;
-
-                    
-                    // cycle through orgs and create matrix for shannon mutual information.
-                    for(typename EA::individual_type::population_type::iterator j=(p)->population().begin(); j!=(p)->population().end(); ++j) {
-                        typename EA::individual_type::individual_type& org=**j;
-                        ++pop_count;
-                        std::vector<double> porg (9);
-                        porg[0] = get<TASK_NOT>(org,0.0);
-                        porg[1] = get<TASK_NAND>(org,0.0);
-                        porg[2] = get<TASK_AND>(org,0.0);
-                        porg[3] = get<TASK_ORNOT>(org,0.0);
-                        porg[4] = get<TASK_OR>(org,0.0);
-                        porg[5] = get<TASK_ANDNOT>(org,0.0);
-                        porg[6] = get<TASK_NOR>(org,0.0);
-                        porg[7] = get<TASK_XOR>(org,0.0);
-                        porg[8] = get<TASK_EQUALS>(org,0.0);
-                        
-                        double total_num_tasks = std::accumulate(porg.begin(), porg.end(), 0);
-                        
-                        // Normalize the tasks and add to matrix
-                        if(total_num_tasks > 0) {
-                            for (unsigned int k=0; k<porg.size(); ++k) {
-                                porg[k] /= total_num_tasks;
-                            }
-                            ++active_pop;
-                            pij.push_back(porg);
-                        }
-                    }
-                    
-                    double shannon_sum = 0.0;
-                    double shannon_norm = 0.0;
-                    if (active_pop > 1) {
-                    
-                        // figure out pj
-                        for (unsigned int k=0; k<pj.size(); ++k) {
-                            for (int m=0; m<active_pop; ++m) {
-                                pj[k] += pij[m][k];
-                            }
-                            pj[k] /= active_pop;
-                        }
-
-                        // compute shannon mutual information based on matrix...
-
-                        double shannon_change = 0.0;
-                        double t_pij = 0.0;
-                        double t_pi = 1.0/active_pop;
-                        double t_pj = 0;
-                        double pij_sum = 0.0;
-                        // calculate shannon mutual information
-                        for (unsigned int i=0; i<active_pop; i++) {
-                            for (int j=0; j<pj.size(); j++) {
-                                t_pij = pij[i][j]/active_pop;
-                                t_pj = pj[j];
-                                pij_sum += t_pij;
-                                if (t_pi && t_pj && t_pij) {
-                                    shannon_change= (t_pij * log(t_pij / (t_pi * t_pj)));
-                                    shannon_sum += shannon_change;
-                                }
-                            }
-                        }
-
-                    }
-                    shannon_norm = shannon_sum / log((double)active_pop);
-
-                    df.write(shannon_sum)
-                    .write(shannon_norm)
-                    .write(active_pop)
-                    .write(pop_count);
-                    df.endl();
-                     
-                     
-                    ++lod_depth;
+                df.add_field("lod_depth");
+                for(std::size_t k=0; k<columns.size(); ++k) {
+                    df.add_field(columns[k]);
                 }
- 
+                
+                write_lod_samples(df, lod_sample(replay, replay.size(), columns, 10, ea));
             }
             
         };
@@ -0,0 +1,168 @@
+//
+//  spatial_patterns.h
+//  ealife
+//
+//  Copyright (c) 2013 Michigan State University. All rights reserved.
+//
+
+#ifndef _EALIFE_SPATIAL_PATTERNS_H_
+#define _EALIFE_SPATIAL_PATTERNS_H_
+
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <boost/algorithm/string.hpp>
+
+#include "cell_bitboard.h"
+
+
+/*! A target pattern for a group's grid: the cells that should perform not
+ and the cells that should perform nand.
+ */
+struct target_pattern {
+    target_pattern(const std::string& l, int x, int y) : label(l), not_cells(x,y), nand_cells(x,y) {
+    }
+
+    std::string label; //!< Column label in the competition's datafile.
+    cell_bitboard not_cells; //!< Cells where not is the target.
+    cell_bitboard nand_cells; //!< Cells where nand is the target.
+};
+
+
+/*! Set of target patterns that groups are scored against.
+
+ Patterns are given as a comma-separated list of [label=]pattern, where
+ pattern is one of:
+
+   rows         nand on even rows, not on odd rows
+   rows_inv     not on even rows, nand on odd rows
+   cols         nand on even columns, not on odd columns
+   cols_inv     not on even columns, nand on odd columns
+   checker      not where x and y have the same parity, nand elsewhere
+   checker_inv  nand where x and y have the same parity, not elsewhere
+   spots        nand on the center of every 3x3 block, not elsewhere
+   file:<path>  one line per row y, one character per column x:
+                '0' = not, '1' = nand, anything else = no target
+
+ The label defaults to the pattern name.  A group's score for a pattern is
+ (n_not + 1) * (n_nand + 1), where n_not and n_nand count the cells whose
+ last task matches the pattern's target.
+ */
+class pattern_library {
+public:
+    //! The six stripe patterns originally built into permute_stripes.
+    static const char* default_spec() {
+        return "one=rows,two=rows_inv,three=cols,four=cols_inv,five=checker,six=checker_inv";
+    }
+
+    //! Constructor.
+    pattern_library() {
+    }
+
+    //! Build the patterns in spec for an x by y grid.
+    void build(const std::string& spec, int x, int y) {
+        _patterns.clear();
+        std::vector<std::string> entries;
+        boost::algorithm::split(entries, spec, boost::algorithm::is_any_of(","));
+        for(std::size_t i=0; i<entries.size(); ++i) {
+            std::string e = boost::algorithm::trim_copy(entries[i]);
+            if(e.empty()) {
+                continue;
+            }
+            std::string label=e, name=e;
+            std::size_t eq = e.find('=');
+            if(eq != std::string::npos) {
+                label = e.substr(0, eq);
+                name = e.substr(eq+1);
+            }
+            _patterns.push_back(make(label, name, x, y));
+        }
+        if(_patterns.empty()) {
+            throw std::invalid_argument("pattern_library: no patterns in \"" + spec + "\"");
+        }
+    }
+
+    //! Returns the number of patterns.
+    std::size_t size() const { return _patterns.size(); }
+
+    //! Returns pattern i.
+    const target_pattern& operator[](std::size_t i) const { return _patterns[i]; }
+
+    /*! Score the group whose not and nand cells are given against every
+     pattern; scores[i] is the score for pattern i.
+     */
+    void score(const cell_bitboard& not_b, const cell_bitboard& nand_b, std::vector<double>& scores) const {
+        scores.resize(_patterns.size());
+        for(std::size_t i=0; i<_patterns.size(); ++i) {
+            double n_not = not_b.count_and(_patterns[i].not_cells);
+            double n_nand = nand_b.count_and(_patterns[i].nand_cells);
+            scores[i] = (n_not + 1) * (n_nand + 1);
+        }
+    }
+
+protected:
+    //! Build the named pattern.
+    static target_pattern make(const std::string& label, const std::string& name, int max_x, int max_y) {
+        target_pattern p(label, max_x, max_y);
+        if(name.compare(0, 5, "file:") == 0) {
+            load(name.substr(5), p);
+            return p;
+        }
+
+        for(int y=0; y<max_y; ++y) {
+            for(int x=0; x<max_x; ++x) {
+                bool nand;
+                if(name == "rows" || name == "rows_inv") {
+                    nand = ((y % 2) == 0);
+                } else if(name == "cols" || name == "cols_inv") {
+                    nand = ((x % 2) == 0);
+                } else if(name == "checker" || name == "checker_inv") {
+                    nand = ((x % 2) != (y % 2));
+                } else if(name == "spots") {
+                    nand = ((x % 3) == 1) && ((y % 3) == 1);
+                } else {
+                    throw std::invalid_argument("pattern_library: unknown pattern " + name);
+                }
+                if(boost::algorithm::ends_with(name, "_inv")) {
+                    nand = !nand;
+                }
+                if(nand) {
+                    p.nand_cells.set(x,y);
+                } else {
+                    p.not_cells.set(x,y);
+                }
+            }
+        }
+        return p;
+    }
+
+    //! Load a pattern mask from filename into p.
+    static void load(const std::string& filename, target_pattern& p) {
+        std::ifstream in(filename.c_str());
+        if(!in) {
+            throw std::invalid_argument("pattern_library: could not open " + filename);
+        }
+        std::string line;
+        int y=0;
+        for( ; (y < p.not_cells.y()) && std::getline(in, line); ++y) {
+            if(static_cast<int>(line.size()) < p.not_cells.x()) {
+                throw std::invalid_argument("pattern_library: short row in " + filename);
+            }
+            for(int x=0; x<p.not_cells.x(); ++x) {
+                if(line[x] == '0') {
+                    p.not_cells.set(x,y);
+                } else if(line[x] == '1') {
+                    p.nand_cells.set(x,y);
+                }
+            }
+        }
+        if(y < p.not_cells.y()) {
+            throw std::invalid_argument("pattern_library: too few rows in " + filename);
+        }
+    }
+
+    std::vector<target_pattern> _patterns; //!< Patterns, in column order.
+};
+
+#endif
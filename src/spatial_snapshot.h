@@ -0,0 +1,136 @@
+//
+//  spatial_snapshot.h
+//  ealife
+//
+//  Copyright (c) 2013 Michigan State University. All rights reserved.
+//
+
+#ifndef _EALIFE_SPATIAL_SNAPSHOT_H_
+#define _EALIFE_SPATIAL_SNAPSHOT_H_
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <boost/cstdint.hpp>
+
+
+/*! Binary spatial snapshots: one record per line of descent depth, holding the
+ state of every cell of the subpopulation's grid after its replay.
+
+ All integers and floats are little-endian.  The file starts with a header:
+
+   char[4]  magic "EASS"
+   uint32   version (1)
+   uint32   x, y    grid dimensions
+
+ followed by records of:
+
+   int32    lod_depth
+   int32    update     (time to threshold, as in the text output)
+   uint8    cell[x*y]  0 = soma, 1 = germ, 2 = empty
+   float32  workload[x*y]
+
+ Cells are ordered x-major (index = x*y_dim + y), the same order as the columns
+ of lod_gls_circle_square_plot.dat.  scripts/spatial_snapshot.py reads this format.
+ */
+namespace spatial_snapshot {
+
+    enum cell_state { SOMA=0, GERM=1, EMPTY=2 };
+
+    const boost::uint32_t version = 1;
+
+    //! A single depth's grid.
+    struct record {
+        record(int x=0, int y=0) : lod_depth(0), update(0), cells(x*y, EMPTY), workload(x*y, 0.0f) {
+        }
+
+        boost::int32_t lod_depth;
+        boost::int32_t update;
+        std::vector<boost::uint8_t> cells;
+        std::vector<float> workload;
+    };
+
+    //! Write v as four little-endian bytes.
+    inline void put_u32(std::ostream& out, boost::uint32_t v) {
+        char b[4] = { static_cast<char>(v & 0xff), static_cast<char>((v >> 8) & 0xff),
+            static_cast<char>((v >> 16) & 0xff), static_cast<char>((v >> 24) & 0xff) };
+        out.write(b, 4);
+    }
+
+    //! Read four little-endian bytes.
+    inline boost::uint32_t get_u32(std::istream& in) {
+        unsigned char b[4];
+        in.read(reinterpret_cast<char*>(b), 4);
+        return b[0] | (b[1] << 8) | (b[2] << 16) | (static_cast<boost::uint32_t>(b[3]) << 24);
+    }
+
+    //! Writes a spatial snapshot file.
+    class writer {
+    public:
+        //! Constructor; writes the header.
+        writer(const std::string& filename, int x, int y) : _out(filename.c_str(), std::ios::binary), _x(x), _y(y) {
+            if(!_out) {
+                throw std::runtime_error("spatial_snapshot::writer: could not open " + filename);
+            }
+            _out.write("EASS", 4);
+            put_u32(_out, version);
+            put_u32(_out, _x);
+            put_u32(_out, _y);
+        }
+
+        //! Append a record.
+        void write(const record& r) {
+            put_u32(_out, static_cast<boost::uint32_t>(r.lod_depth));
+            put_u32(_out, static_cast<boost::uint32_t>(r.update));
+            _out.write(reinterpret_cast<const char*>(&r.cells[0]), r.cells.size());
+            for(std::size_t i=0; i<r.workload.size(); ++i) {
+                boost::uint32_t w;
+                std::memcpy(&w, &r.workload[i], sizeof(w));
+                put_u32(_out, w);
+            }
+        }
+
+    protected:
+        std::ofstream _out;
+        int _x, _y;
+    };
+
+    //! Reads a spatial snapshot file.
+    class reader {
+    public:
+        //! Constructor; reads and checks the header.
+        reader(const std::string& filename) : _in(filename.c_str(), std::ios::binary) {
+            char magic[4];
+            _in.read(magic, 4);
+            if(!_in || (std::strncmp(magic, "EASS", 4) != 0) || (get_u32(_in) != version)) {
+                throw std::runtime_error("spatial_snapshot::reader: not a spatial snapshot: " + filename);
+            }
+            _x = get_u32(_in);
+            _y = get_u32(_in);
+        }
+
+        int x() const { return _x; }
+        int y() const { return _y; }
+
+        //! Read the next record; returns false at end of file.
+        bool read(record& r) {
+            r = record(_x, _y);
+            r.lod_depth = static_cast<boost::int32_t>(get_u32(_in));
+            r.update = static_cast<boost::int32_t>(get_u32(_in));
+            _in.read(reinterpret_cast<char*>(&r.cells[0]), r.cells.size());
+            for(std::size_t i=0; i<r.workload.size(); ++i) {
+                boost::uint32_t w = get_u32(_in);
+                std::memcpy(&r.workload[i], &w, sizeof(w));
+            }
+            return !_in.fail();
+        }
+
+    protected:
+        std::ifstream _in;
+        int _x, _y;
+    };
+}
+
+#endif
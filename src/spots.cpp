@@ -69,7 +69,10 @@ struct ts_configuration : public abstract_configuration<EA> {
         append_isa<jump_head>(ea);
         
         add_event<spots>(this,ea);
+        add_event<not_neighbors_birth>(this,ea);
+        add_event<not_neighbors_death>(this,ea);
         add_event<ts_birth_event>(this,ea);
+        add_event<ts_death_event>(this,ea);
     }
     
     //! Initialize! Things are live and are mostly setup. All the objects are there, but they
@@ -11,6 +11,11 @@
 #define _EALIFE_STRIPES_H_
 #include "selfrep_not_ancestor.h"
 #include "resource_consumption.h"
+#include "task_id.h"
+#include "spatial_patterns.h"
+#include "group_fitness.h"
+#include "fitness_tournament.h"
+#include "task_switch_totals.h"
 
 #include <boost/accumulators/accumulators.hpp>
 #include <boost/accumulators/statistics/stats.hpp>
@@ -34,193 +39,154 @@
 using namespace ealib;
 
 
-LIBEA_MD_DECL(STRIPE_FIT, "ea.stripes.fit", int); // count the number of organisms that have the right color stripe
 LIBEA_MD_DECL(ANCESTOR, "ea.stripes.ancestor", int);
 
 LIBEA_MD_DECL(NUM_PROPAGULE_CELL, "ea.stripes.num_propagule_cell", int);
+LIBEA_MD_DECL(STRIPE_PATTERNS, "ea.stripes.patterns", std::string); // target patterns; see pattern_library
 
 
 
 
-/*! Compete to evolve stripes -- even number rows nand; odd number rows not
+/*! Scores one group for permute_stripes; see evaluate_groups.
+ 
+ Row layout: best score, the score for each pattern, then the group's number
+ of organisms whose last task was not, whose last task was nand, and of
+ organisms in all.
+ 
+ The cell bitboards are filled from the group's organisms at each
+ competition: tasks are performed far more often than groups compete, and
+ the per-subpopulation reaction events have nowhere but meta-data to keep a
+ board between competitions.
+ */
+struct stripe_scorer {
+    stripe_scorer(const pattern_library& patterns, int x, int y) : _patterns(&patterns), _not(x,y), _nand(x,y) {
+        _not_id = task_ids::id("not");
+        _nand_id = task_ids::id("nand");
+    }
+    
+    //! Returns the number of values written per group.
+    std::size_t width() const { return _patterns->size() + 4; }
+    
+    template <typename Group>
+    void operator()(Group& grp, double* row) {
+        // one pass to mark which cells last performed not / nand...
+        _not.clear();
+        _nand.clear();
+        int num_org = 0;
+        int num_not = 0;
+        int num_nand = 0;
+        
+        for(typename Group::ea_type::population_type::iterator j=grp.population().begin(); j!=grp.population().end(); ++j) {
+            ++num_org;
+            int lt = get<LAST_TASK_ID>(**j,-1);
+            if (lt == _not_id) {
+                ++num_not;
+                _not.set_at(grp.ea().env().location((**j).position()));
+            } else if (lt == _nand_id) {
+                ++num_nand;
+                _nand.set_at(grp.ea().env().location((**j).position()));
+            }
+        }
+        
+        // ...then score the group against every pattern.
+        _patterns->score(_not, _nand, _scores);
+        double best = 0.0;
+        for (std::size_t k=0; k<_scores.size(); ++k) {
+            row[k+1] = _scores[k];
+            best = std::max(best, _scores[k]);
+        }
+        row[0] = best;
+        row[_scores.size()+1] = num_not;
+        row[_scores.size()+2] = num_nand;
+        row[_scores.size()+3] = num_org;
+    }
+    
+    const pattern_library* _patterns; //!< Target patterns.
+    int _not_id, _nand_id; //!< Interned task ids.
+    cell_bitboard _not, _nand; //!< Cells of the current group that last performed not / nand.
+    std::vector<double> _scores; //!< Current group's score for each pattern.
+};
+
+
+/*! Compete to evolve spatial patterns of not and nand.
+ 
+ Groups are scored against every pattern in ea.stripes.patterns (see
+ pattern_library; by default the six stripe patterns: even number rows nand,
+ odd number rows not, and so on), and compete on their best score.
  */
 template <typename EA>
 struct permute_stripes : periodic_event<METAPOP_COMPETITION_PERIOD,EA> {
+    typedef boost::accumulators::accumulator_set<double, boost::accumulators::stats<boost::accumulators::tag::mean, boost::accumulators::tag::max> > acc_type;
+    
     permute_stripes(EA& ea) : periodic_event<METAPOP_COMPETITION_PERIOD,EA>(ea), _df("permute_stripes.dat") {
+    }
+    
+    virtual ~permute_stripes() {
+    }
+    
+    //! Build the pattern library and masks, and lay out the datafile.
+    void initialize(EA& ea) {
+        int max_x = get<SPATIAL_X>(ea);
+        int max_y = get<SPATIAL_Y>(ea);
+        _patterns.build(get<STRIPE_PATTERNS>(ea, std::string(pattern_library::default_spec())), max_x, max_y);
+        
         _df.add_field("update")
         .add_field("mean_fitness")
-        .add_field("max_fitness")
-        .add_field("mean_one_fitness")
-        .add_field("max_one_fitness")
-        .add_field("mean_two_fitness")
-        .add_field("max_two_fitness")
-        .add_field("mean_three_fitness")
-        .add_field("max_three_fitness")
-        .add_field("mean_four_fitness")
-        .add_field("max_four_fitness")
-        .add_field("mean_five_fitness")
-        .add_field("max_five_fitness")
-        .add_field("mean_six_fitness")
-        .add_field("max_six_fitness")
-        .add_field("mean_num_not")
+        .add_field("max_fitness");
+        for (std::size_t k=0; k<_patterns.size(); ++k) {
+            _df.add_field("mean_" + _patterns[k].label + "_fitness")
+            .add_field("max_" + _patterns[k].label + "_fitness");
+        }
+        _df.add_field("mean_num_not")
         .add_field("max_num_not")
         .add_field("mean_num_nand")
         .add_field("max_num_nand")
         .add_field("mean_num_org")
         .add_field("max_num_org");
-
-    }
-    
-    virtual ~permute_stripes() {
     }
     
     virtual void operator()(EA& ea) {
         using namespace boost::accumulators;
-        accumulator_set<double, stats<tag::mean, tag::max> > fit;
-        accumulator_set<double, stats<tag::mean, tag::max> > one_fit;
-        accumulator_set<double, stats<tag::mean, tag::max> > two_fit;
-        accumulator_set<double, stats<tag::mean, tag::max> > three_fit;
-        accumulator_set<double, stats<tag::mean, tag::max> > four_fit;
-        accumulator_set<double, stats<tag::mean, tag::max> > five_fit;
-        accumulator_set<double, stats<tag::mean, tag::max> > six_fit;
-        accumulator_set<double, stats<tag::mean, tag::max> > num_not;
-        accumulator_set<double, stats<tag::mean, tag::max> > num_nand;
-        accumulator_set<double, stats<tag::mean, tag::max> > num_org;
-
-        
-        
+        if (_patterns.size() == 0) {
+            initialize(ea);
+        }
         
-        // calculate "fitness":
-        for(typename EA::iterator i=ea.begin(); i!=ea.end(); ++i) {
-            // vert stripes
-            double one_fit_not = 0;
-            double one_fit_nand = 0;
-            double two_fit_not = 0;
-            double two_fit_nand = 0;
-            // horizontal stripes
-            double three_fit_not = 0;
-            double three_fit_nand = 0;
-            double four_fit_not = 0;
-            double four_fit_nand = 0;
-            // diagonal stripes
-            double five_fit_not = 0;
-            double five_fit_nand = 0;
-            double six_fit_not = 0;
-            double six_fit_nand = 0;
-            
-            double tmp_num_not = 0;
-            double tmp_num_nand = 0;
-            
-            int tmp_num_org = 0;
-
-
-            for(typename EA::individual_type::ea_type::population_type::iterator j=i->population().begin(); j!=i->population().end(); ++j) {
-                ++tmp_num_org;
-                std::string lt = get<LAST_TASK>(**j,"");
-                if (((i->ea().env().location((**j).position())->y) % 2) == 0) {
-                    if (lt == "nand") {
-                        ++one_fit_nand;
-                        ++tmp_num_nand;
-                    }
-                    if (lt == "not") {
-                        ++two_fit_not;
-                        ++tmp_num_not;
-                    }
-                } else {
-                    if(lt == "not") {
-                        ++one_fit_not;
-                        ++tmp_num_not;
-                    }
-                    if (lt == "nand") {
-                        ++two_fit_nand;
-                        ++tmp_num_nand;
-                    }
-                }
-                
-                if (((i->ea().env().location((**j).position())->x) % 2) == 0) {
-                    if (lt == "nand") {
-                        ++three_fit_nand;
-                    }
-                    if (lt == "not") {
-                        ++four_fit_not;
-                    }
-                } else {
-                    if(lt == "not") {
-                        ++three_fit_not;
-                    }
-                    if (lt == "nand") {
-                        ++four_fit_nand;
-                    }
-                }
-                
-                
-                if (((i->ea().env().location((**j).position())->x) % 2) ==
-                    ((i->ea().env().location((**j).position())->y) % 2)) {
-                    
-                    if(lt == "not") {
-                        ++five_fit_not;
-                    }
-                    if (lt == "nand") {
-                        ++six_fit_nand;
-                    }
-                } else {
-                    if(lt == "nand") {
-                        ++five_fit_nand;
-                    }
-                    if (lt == "not") {
-                        ++six_fit_not;
-                    }
-                }
-
+        // score all groups (in parallel), then reduce:
+        stripe_scorer scorer(_patterns, get<SPATIAL_X>(ea), get<SPATIAL_Y>(ea));
+        const std::size_t w = scorer.width();
+        evaluate_groups(ea, scorer, w, _rows);
+        
+        acc_type fit;
+        std::vector<acc_type> pattern_fit(_patterns.size());
+        acc_type num_not;
+        acc_type num_nand;
+        acc_type num_org;
+        
+        for (std::size_t g=0; g<_rows.size(); g+=w) {
+            const double* row = &_rows[g];
+            fit(row[0]);
+            for (std::size_t k=0; k<_patterns.size(); ++k) {
+                pattern_fit[k](row[k+1]);
             }
-            double tmp_one_fit = (one_fit_not + 1)  * (one_fit_nand + 1);
-            double tmp_two_fit = (two_fit_not + 1)  * (two_fit_nand + 1);
-            double tmp_three_fit = (three_fit_not + 1)  * (three_fit_nand + 1);
-            double tmp_four_fit = (four_fit_not + 1)  * (four_fit_nand + 1);
-            double tmp_five_fit = (five_fit_not + 1)  * (five_fit_nand + 1);
-            double tmp_six_fit = (six_fit_not + 1)  * (six_fit_nand + 1);
-            double tmp_fit = std::max(tmp_one_fit, tmp_two_fit);
-            tmp_fit = std::max(tmp_fit, tmp_three_fit);
-            tmp_fit = std::max(tmp_fit, tmp_four_fit);
-            tmp_fit = std::max(tmp_fit, tmp_five_fit);
-            tmp_fit = std::max(tmp_fit, tmp_six_fit);
-            
-            
-            fit(tmp_fit);
-            one_fit(tmp_one_fit);
-            two_fit(tmp_two_fit);
-            three_fit(tmp_three_fit);
-            four_fit(tmp_four_fit);
-            five_fit(tmp_five_fit);
-            six_fit(tmp_six_fit);
-            
-            num_org(tmp_num_org);
-            num_nand(tmp_num_nand);
-            num_not(tmp_num_not);
-
-
-            put<STRIPE_FIT>(tmp_fit,*i);
+            num_not(row[_patterns.size()+1]);
+            num_nand(row[_patterns.size()+2]);
+            num_org(row[_patterns.size()+3]);
         }
         
-        
-
+        // fitness (best score) of each group, in population order:
+        _fitness.resize(_rows.size() / w);
+        for (std::size_t g=0; g<_fitness.size(); ++g) {
+            _fitness[g] = _rows[g * w];
+        }
         
         _df.write(ea.current_update())
         .write(mean(fit))
-        .write(max(fit))
-        .write(mean(one_fit))
-        .write(max(one_fit))
-        .write(mean(two_fit))
-        .write(max(two_fit))
-        .write(mean(three_fit))
-        .write(max(three_fit))
-        .write(mean(four_fit))
-        .write(max(four_fit))
-        .write(mean(five_fit))
-        .write(max(five_fit))
-        .write(mean(six_fit))
-        .write(max(six_fit))
-        .write(mean(num_not))
+        .write(max(fit));
+        for (std::size_t k=0; k<pattern_fit.size(); ++k) {
+            _df.write(mean(pattern_fit[k]))
+            .write(max(pattern_fit[k]));
+        }
+        _df.write(mean(num_not))
         .write(max(num_not))
         .write(mean(num_nand))
         .write(max(num_nand))
@@ -231,7 +197,7 @@ struct permute_stripes : periodic_event<METAPOP_COMPETITION_PERIOD,EA> {
         std::size_t n=get<META_POPULATION_SIZE>(ea);
         typename EA::population_type offspring; // container of (pointers to) subpopulations
         recombine_n(ea.population(), offspring,
-                    selection::tournament < access::meta_data<STRIPE_FIT> > (n, ea.population(), ea),
+                    fitness_tournament(_fitness),
                     recombination::propagule_without_replacement(),
                     n, ea);
         
@@ -253,6 +219,7 @@ struct permute_stripes : periodic_event<METAPOP_COMPETITION_PERIOD,EA> {
                 typename EA::individual_type::ea_type::individual_ptr_type o = (*i)->ea().copy_individual(g);
                 (*i)->insert((*i)->end(), o);
             }
+            ts_count_totals((*i)->ea().population(), (*i)->ea());
         }
         
 
@@ -271,6 +238,9 @@ struct permute_stripes : periodic_event<METAPOP_COMPETITION_PERIOD,EA> {
     }
     
     datafile _df;
+    pattern_library _patterns; //!< Target patterns.
+    std::vector<double> _rows; //!< Per-group results of stripe_scorer.
+    std::vector<double> _fitness; //!< Per-group fitness, for selection.
 };
 
 #endif
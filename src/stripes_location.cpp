@@ -69,6 +69,7 @@ struct configuration : public default_configuration {
         add_event<task_resource_consumption>(ea);
         add_event<task_switching_cost>(ea);
         add_event<ts_birth_event>(ea);
+        add_event<ts_death_event>(ea);
     }
     
     //! Initialize! Things are live and are mostly setup. All the objects are there, but they
@@ -185,9 +186,11 @@ public:
         add_option<ANALYSIS_INPUT>(this);
         add_option<NUM_PROPAGULE_GERM>(this);
         add_option<NUM_PROPAGULE_CELL>(this);
+        add_option<STRIPE_PATTERNS>(this);
         
         // ts specific options
         add_option<TASK_SWITCHING_COST>(this);
+        add_option<TS_TRACKING_PERIOD>(this);
         add_option<GERM_MUTATION_PER_SITE_P>(this);
         
         // stripes
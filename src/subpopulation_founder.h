@@ -11,17 +11,92 @@
 
 #include <ea/digital_evolution.h>
 #include <ea/digital_evolution/hardware.h>
+#include <boost/serialization/nvp.hpp>
+#include <boost/serialization/split_member.hpp>
+#include <boost/serialization/version.hpp>
+#include <boost/mpl/int.hpp>
 
 
 using namespace ealib;
 using namespace boost::accumulators;
 
 
+/*! Compact record of a subpopulation's founding organism.
+ 
+ Group replication and the line of descent tools only need the founder's
+ genome and its original size, so that is all that is kept: no hardware
+ state, metadata or other per-organism bookkeeping is copied along with each
+ subpopulation or written into each checkpoint and LOD entry.
+ */
+template <typename Organism>
+class founder_record {
+public:
+    typedef Organism organism_type;
+    typedef typename Organism::representation_type representation_type;
+    
+    //! Constructor.
+    founder_record() : _original_size(0) {
+    }
+    
+    //! Record organism o as the founder.
+    founder_record& operator=(const organism_type& o) {
+        _repr = o.repr();
+        _original_size = o.hw().original_size();
+        return *this;
+    }
+    
+    //! Returns the founder's genome (as it was when the founder was recorded).
+    representation_type& repr() { return _repr; }
+    
+    //! Returns the founder's genome size at birth.
+    std::size_t original_size() const { return _original_size; }
+    
+protected:
+    representation_type _repr; //!< Founder's genome.
+    std::size_t _original_size; //!< Founder's genome size at birth.
+    
+private:
+    friend class boost::serialization::access;
+    
+    template<class Archive>
+    void serialize(Archive & ar, const unsigned int version) {
+        ar & boost::serialization::make_nvp("repr", _repr);
+        ar & boost::serialization::make_nvp("original_size", _original_size);
+    }
+};
+
+
+//! Returns the genome of founder f, truncated to its original size.
+template <typename Organism>
+typename Organism::representation_type founder_genome(Organism& f) {
+    typename Organism::representation_type g = f.repr();
+    g.resize(f.hw().original_size());
+    return g;
+}
+
+//! Returns the genome of founder f, truncated to its original size.
+template <typename Organism>
+typename Organism::representation_type founder_genome(founder_record<Organism>& f) {
+    typename Organism::representation_type g = f.repr();
+    g.resize(f.original_size());
+    return g;
+}
+
+
+/*! Subpopulation that records its founder as a founder_record.
+ 
+ Serialization format: version 0 archives (checkpoints and LOD files written
+ before founder_record, including those from ealib's population_founder) store
+ the founder as a complete organism, and are still loaded; only its genome and
+ original size are kept.  Version 1 archives, which are all that is written
+ now, store the founder_record, and cannot be read by older binaries.
+ */
 template <typename Individual>
 class subpopulation_founder : public Individual {
 public:
     typedef Individual base_type;
-    typedef typename Individual::individual_type founder_type;
+    typedef typename Individual::individual_type founder_organism_type;
+    typedef founder_record<founder_organism_type> founder_type;
     typedef typename Individual::individual_ptr_type founder_ptr_type;
 
     
@@ -56,13 +131,42 @@ private:
     friend class boost::serialization::access;
     
     template<class Archive>
-    void serialize(Archive & ar, const unsigned int version) {
+    void save(Archive & ar, const unsigned int version) const {
         ar & boost::serialization::make_nvp("founder", _founder);
         ar & boost::serialization::make_nvp("individual", boost::serialization::base_object<base_type>(*this));
     }
+    
+    template<class Archive>
+    void load(Archive & ar, const unsigned int version) {
+        if(version == 0) {
+            founder_organism_type f;
+            ar & boost::serialization::make_nvp("founder", f);
+            _founder = f;
+        } else {
+            ar & boost::serialization::make_nvp("founder", _founder);
+        }
+        ar & boost::serialization::make_nvp("individual", boost::serialization::base_object<base_type>(*this));
+    }
+    
+    BOOST_SERIALIZATION_SPLIT_MEMBER();
 };
 
 
+namespace boost {
+    namespace serialization {
+        
+        //! Version 1: the founder is stored as a founder_record; see subpopulation_founder.
+        template <typename Individual>
+        struct version<subpopulation_founder<Individual> > {
+            typedef mpl::int_<1> type;
+            typedef mpl::integral_c_tag tag;
+            BOOST_STATIC_CONSTANT(int, value = version::type::value);
+        };
+        
+    } // serialization
+} // boost
+
+
 /*! Chains together offspring and their parents, called for every inheritance event.
  */
 template <typename EA>
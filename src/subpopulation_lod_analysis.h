@@ -20,6 +20,11 @@
 //#include <ea/analysis/tool.h>
 #include <ea/digital_evolution/instruction_set.h>
 #include <ea/digital_evolution/discrete_spatial_environment.h>
+#include <boost/lexical_cast.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include "lod_replay.h"
+#include "spatial_snapshot.h"
 
 
 
@@ -45,6 +50,49 @@
          line_of_descent<EA> lod = lod_load(get<ANALYSIS_INPUT>(ea), ea);
          */
         
+        /*! Replays a single depth for the lod_gls_aging_res_over_time tools; returns
+         the resources amassed during each 1000-update window of a 10000-update replay.
+         */
+        template <typename EA>
+        struct gls_aging_replay : lod_replay<EA> {
+            gls_aging_replay(line_of_descent<EA>& lod, EA& ea) : lod_replay<EA>(lod, ea) {
+            }
+            
+            std::vector<double> operator()(int lod_depth) {
+                typename EA::individual_ptr_type p = this->founder_ea(lod_depth);
+                
+                // replay!
+                int res_reset_inc = 500;
+                int res_resource_thresh = 500;
+                int cur_update = 0;
+                int max_update = 10000;
+                int num_rep = 0;
+                int prev_res = 0;
+                std::vector<double> row;
+                
+                while (cur_update < max_update){
+                    p->update();
+                    ++cur_update;
+                    
+                    if (get<GROUP_RESOURCE_UNITS>(*p,0) >= res_resource_thresh) {
+                        p->env().reset_resources();
+                        
+                        res_resource_thresh += res_reset_inc;
+                        num_rep++;
+                        
+                    }
+                    if ((cur_update % 1000) == 0) {
+                        double cur_res = get<GROUP_RESOURCE_UNITS>(*p,0);
+                        double res = cur_res - prev_res;
+                        prev_res = cur_res;
+                        row.push_back(res);
+                    }
+                }
+                return row;
+            }
+        };
+        
+        
         /*! lod_gls_aging_res_over_time */
 //        template <typename EA>
 //        struct lod_gls_aging_res_over_time_compact : public ealib::analysis::unary_function<EA> {
@@ -56,80 +104,20 @@
 
         LIBEA_ANALYSIS_TOOL(lod_gls_aging_res_over_time_compact) {
                 line_of_descent<EA> lod = lod_load(get<ANALYSIS_INPUT>(ea), ea);
+                gls_aging_replay<EA> replay(lod, ea);
                 
-                typename line_of_descent<EA>::iterator i=lod.begin(); ++i;
-                
+                std::vector<std::string> columns;
+                for (int u=1000; u<=10000; u+=1000) {
+                    columns.push_back("res" + boost::lexical_cast<std::string>(u));
+                }
                 
                 datafile df("lod_gls_aging_res_over_time_compact.dat");
-                df.add_field("lod_depth")
-                .add_field("res1000")
-                .add_field("res2000")
-                .add_field("res3000")
-                .add_field("res4000")
-                .add_field("res5000")
-                .add_field("res6000")
-                .add_field("res7000")
-                .add_field("res8000")
-                .add_field("res9000")
-                .add_field("res10000");
-                
-                
-                int lod_depth = 0;
-                // skip def ancestor (that's what the +1 does)
-                for( ; i!=lod.end(); ++i) {
-                    
-                    
-                    if ((lod_depth % 10) != 0) {
-                        lod_depth++;
-                        continue;
-                    }
-                    
-                    
-                    
-                    // **i is the EA, AS OF THE TIME THAT IT DIED!
-                    
-                    // To replay, need to create a new ea
-                    // setup the population (really, an ea):
-                    typename EA::individual_ptr_type p = ea.make_individual();
-                    p->rng().reset(get<RNG_SEED>(**i));
-                    
-                    // setup the founder
-                    typename EA::individual_type::individual_ptr_type o= (*i)->make_individual((*i)->founder().repr());
-                    o->hw().initialize();
-                    p->append(o);
-                    
-                    // replay!
-                    int res_reset_inc = 500;
-                    int res_resource_thresh = 500;
-                    int cur_update = 0;
-                    int max_update = 10000;
-                    int num_rep = 0;
-                    int prev_res = 0;
-                    // and run till the group amasses the right amount of resources
-                    df.write(lod_depth);
-                    
-                    while (cur_update < max_update){
-                        p->update();
-                        ++cur_update;
-                        
-                        if (get<GROUP_RESOURCE_UNITS>(*p,0) >= res_resource_thresh) {
-                            p->env().reset_resources();
-                            
-                            res_resource_thresh += res_reset_inc;
-                            num_rep++;
-                            
-                        }
-                        if ((cur_update % 1000) == 0) {
-                            double cur_res = get<GROUP_RESOURCE_UNITS>(*p,0);
-                            double res = cur_res - prev_res;
-                            prev_res = cur_res;
-                            df.write(res);
-                        }
-                    }
-                    
-                    df.endl();
-                    ++lod_depth;
+                df.add_field("lod_depth");
+                for (std::size_t k=0; k<columns.size(); ++k) {
+                    df.add_field(columns[k]);
                 }
+                
+                write_lod_samples(df, lod_sample(replay, replay.size(), columns, 10, ea));
             }
             
  //       };
@@ -147,73 +135,27 @@
         
         
                 line_of_descent<EA> lod = lod_load(get<ANALYSIS_INPUT>(ea), ea);
+                gls_aging_replay<EA> replay(lod, ea);
                 
-                typename line_of_descent<EA>::iterator i=lod.begin(); ++i;
-                
+                std::vector<std::string> columns;
+                for (int u=1000; u<=10000; u+=1000) {
+                    columns.push_back("res" + boost::lexical_cast<std::string>(u));
+                }
                 
                 datafile df("lod_gls_aging_res_over_time.dat");
                 df.add_field("lod_depth")
                 .add_field("update")
                 .add_field("res");
 
-                
-                int lod_depth = 0;
-                // skip def ancestor (that's what the +1 does)
-                for( ; i!=lod.end(); ++i) {
-                    
-                    
-                    if ((lod_depth % 10) != 0) {
-                        lod_depth++;
-                        continue;
+                typedef typename lod_sampler<gls_aging_replay<EA> >::sample_type sample_type;
+                sample_type samples = lod_sample(replay, replay.size(), columns, 10, ea);
+                for (typename sample_type::iterator j=samples.begin(); j!=samples.end(); ++j) {
+                    for (std::size_t k=0; k<j->second.size(); ++k) {
+                        df.write(j->first);
+                        df.write((k+1)*1000);
+                        df.write(j->second[k]);
+                        df.endl();
                     }
-                    
-                    
-                    
-                    // **i is the EA, AS OF THE TIME THAT IT DIED!
-                    
-                    // To replay, need to create a new ea
-                    // setup the population (really, an ea):
-                    typename EA::individual_ptr_type p = ea.make_individual();
-                    p->rng().reset(get<RNG_SEED>(**i));
-                    
-                    // setup the founder
-                    typename EA::individual_type::individual_ptr_type o= (*i)->make_individual((*i)->founder().repr());
-                    o->hw().initialize();
-                    p->append(o);
-                    
-                    // replay!
-                    int res_reset_inc = 500;
-                    int res_resource_thresh = 500;
-                    int cur_update = 0;
-                    int max_update = 10000;
-                    int num_rep = 0;
-                    int prev_res = 0;
-                    // and run till the group amasses the right amount of resources
-                    while (cur_update < max_update){
-                        p->update();
-                        ++cur_update;
-                        
-                        if (get<GROUP_RESOURCE_UNITS>(*p,0) >= res_resource_thresh) {
-                            p->env().reset_resources();
-                            
-                            res_resource_thresh += res_reset_inc;
-                            num_rep++;
-                            
-                        }
-                        if ((cur_update % 1000) == 0) {
-                            double cur_res = get<GROUP_RESOURCE_UNITS>(*p,0);
-                            double res = cur_res - prev_res;
-                            prev_res = cur_res;
-                            df.write(lod_depth);
-                            df.write(cur_update);
-                            df.write(res);
-                            df.endl();
-                        }
-                    }
-                    
-//                    df.write(num_rep);
-                    
-                    ++lod_depth;
                 }
             }
             
@@ -236,66 +178,127 @@
                 
                 line_of_descent<EA> lod = lod_load(get<ANALYSIS_INPUT>(ea), ea);
                 
-                typename line_of_descent<EA>::iterator i=lod.begin(); ++i;
-                
-                datafile df("lod_gls_circle_square_plot.dat");
-                df.add_field("lod_depth");
+                const int max_x = get<SPATIAL_X>(ea);
+                const int max_y = get<SPATIAL_Y>(ea);
                 
+                // with ea.analysis.lod_spatial_snapshot set, write one binary record
+                // per depth (see spatial_snapshot.h) instead of a text row:
+                boost::scoped_ptr<datafile> df;
+                boost::scoped_ptr<spatial_snapshot::writer> snap;
+                if(get<LOD_SPATIAL_SNAPSHOT>(ea, false)) {
+                    snap.reset(new spatial_snapshot::writer("lod_gls_circle_square_plot.snap", max_x, max_y));
+                } else {
+                    df.reset(new datafile("lod_gls_circle_square_plot.dat"));
+                    df->add_field("lod_depth");
+                }
+                spatial_snapshot::record rec(max_x, max_y);
                 
-                int lod_depth = 0;
-                // skip def ancestor (that's what the +1 does)
-                for( ; i!=lod.end(); ++i) {
-                    
-                    df.write(lod_depth);
-                    
-                    // **i is the EA, AS OF THE TIME THAT IT DIED!
-                    
-                    // To replay, need to create new eas for each knockout exper.
-                    // setup the population (really, an ea):
-                    typename EA::individual_ptr_type control_ea = ea.make_individual();
-                    control_ea->rng().reset(get<RNG_SEED>(**i));
-                    
-                    // setup the founder
-                    typename EA::individual_type::individual_ptr_type o= (*i)->make_individual((*i)->founder().repr());
-                    o->hw().initialize();
-                    control_ea->append(o);
+                lod_replay<EA> replay(lod, ea);
+                for (int lod_depth=0; lod_depth<replay.size(); ++lod_depth) {
+                    typename EA::individual_ptr_type control_ea = replay.founder_ea(lod_depth);
                     
                     // replay! till the group amasses the right amount of resources
                     // or exceeds its window...
-                    int cur_update = 0;
-                    int update_max = 10000;
-                    // and run till the group amasses the right amount of resources
-                    while ((get<GROUP_RESOURCE_UNITS>(*control_ea,0) < get<GROUP_REP_THRESHOLD>(*control_ea)) &&
-                           (cur_update < update_max)){
-                        control_ea->update();
-                        ++cur_update;
-                    }
-                    df.write(cur_update);
+                    replay_result r = replay.replay_to_threshold(*control_ea, 10000);
+                    rec.lod_depth = lod_depth;
+                    rec.update = r.updates;
                     
                     // grab info based on location...
-                    for (int x=0; x < get<SPATIAL_X>(ea); ++x) {
-                        for (int y=0; y<get<SPATIAL_Y>(ea); ++y){
-                            typename EA::individual_type::environment_type::location_type l = control_ea->env().location(x,y);
+                    for (int x=0; x < max_x; ++x) {
+                        for (int y=0; y<max_y; ++y){
+                            typename EA::individual_type::environment_type::location_type& l = control_ea->env().location(x,y);
+                            int i = x*max_y + y;
                             if (l.occupied()) {
-                                df.write(get<GERM_STATUS>(*l.inhabitant(), 0))
-                                .write(get<WORKLOAD>(*l.inhabitant(),0));
+                                rec.cells[i] = get<GERM_STATUS>(*l.inhabitant(), 0) ? spatial_snapshot::GERM : spatial_snapshot::SOMA;
+                                rec.workload[i] = get<WORKLOAD>(*l.inhabitant(),0);
                             } else {
-                                df.write("2")
-                                .write("0");
+                                rec.cells[i] = spatial_snapshot::EMPTY;
+                                rec.workload[i] = 0.0f;
                             }
-                            
                         }
                     }
                     
-                    df.endl();
-                    
-                    ++lod_depth;
+                    if(snap) {
+                        snap->write(rec);
+                    } else {
+                        df->write(rec.lod_depth).write(rec.update);
+                        for(std::size_t i=0; i<rec.cells.size(); ++i) {
+                            df->write(static_cast<int>(rec.cells[i])).write(rec.workload[i]);
+                        }
+                        df->endl();
+                    }
                 }
             }
             
 //};
 
 
+        /*! Replays a single depth for lod_gls_germ_soma_mean_var.
+         */
+        template <typename EA>
+        struct gls_germ_soma_replay : lod_replay<EA> {
+            gls_germ_soma_replay(line_of_descent<EA>& lod, EA& ea) : lod_replay<EA>(lod, ea) {
+            }
+            
+            std::vector<double> operator()(int lod_depth) {
+                typename EA::individual_ptr_type control_ea = this->founder_ea(lod_depth);
+                
+                // replay! till the group amasses the right amount of resources
+                // or exceeds its window...
+                replay_result r = this->replay_to_threshold(*control_ea, 10000);
+                
+                double germ_count = 0;
+                double pop_count = 0;
+                accumulator_set<double, stats<tag::mean, tag::variance> > germ_workload_acc;
+                accumulator_set<double, stats<tag::mean, tag::variance> > soma_workload_acc;
+                
+                for(typename EA::individual_type::population_type::iterator j=control_ea->population().begin(); j!=control_ea->population().end(); ++j) {
+                    typename EA::individual_type::individual_type& org=**j;
+                    if (get<GERM_STATUS>(org, true)) {
+                        ++germ_count;
+                        germ_workload_acc(get<WORKLOAD>(org, 0.0));
+                    } else {
+                        soma_workload_acc(get<WORKLOAD>(org, 0.0));
+                    }
+                    ++pop_count;
+                }
+                
+                
+                // How many different types of tasks does the group do?
+                int task_type_count = 0;
+                if (get<TASK_NOT>(*control_ea,0.0)) ++task_type_count;
+                if (get<TASK_NAND>(*control_ea,0.0)) ++task_type_count;
+                if (get<TASK_AND>(*control_ea,0.0)) ++task_type_count;
+                if (get<TASK_ORNOT>(*control_ea,0.0)) ++task_type_count;
+                if (get<TASK_OR>(*control_ea,0.0)) ++task_type_count;
+                if (get<TASK_ANDNOT>(*control_ea,0.0)) ++task_type_count;
+                if (get<TASK_NOR>(*control_ea,0.0)) ++task_type_count;
+                if (get<TASK_XOR>(*control_ea,0.0)) ++task_type_count;
+                if (get<TASK_EQUALS>(*control_ea,0.0)) ++task_type_count;
+                
+                double germ_percent = (germ_count/pop_count);
+                std::vector<double> row;
+                row.push_back(r.updates);
+                row.push_back(task_type_count);
+                row.push_back(germ_count);
+                row.push_back(pop_count);
+                row.push_back(germ_percent);
+                row.push_back(mean(germ_workload_acc));
+                row.push_back(variance(germ_workload_acc));
+                
+                if (germ_count != pop_count){
+                    row.push_back(mean(soma_workload_acc));
+                    row.push_back(variance(soma_workload_acc));
+                } else {
+                    row.push_back(0);
+                    row.push_back(0);
+                }
+                row.push_back(r.stop);
+                return row;
+            }
+        };
+        
+        
         /*! lod_gls_germ_soma_mean_var reruns each subpopulation along a line of descent - setup for circle / square plot
          */
 //        template <typename EA>
@@ -309,104 +312,27 @@
 LIBEA_ANALYSIS_TOOL(lod_gls_germ_soma_mean_var) {
 
                 line_of_descent<EA> lod = lod_load(get<ANALYSIS_INPUT>(ea), ea);
+                gls_germ_soma_replay<EA> replay(lod, ea);
                 
-                typename line_of_descent<EA>::iterator i=lod.begin(); ++i;
+                std::vector<std::string> columns;
+                columns.push_back("time_to_first_rep");
+                columns.push_back("num_types_of_tasks");
+                columns.push_back("num_germ");
+                columns.push_back("num_pop");
+                columns.push_back("germ_percent");
+                columns.push_back("mean_germ_workload");
+                columns.push_back("mean_germ_workload_var");
+                columns.push_back("mean_soma_workload");
+                columns.push_back("mean_soma_workload_var");
+                columns.push_back("replay_stop");
                 
                 datafile df("lod_gls_germ_soma_mean_var.dat");
-                df.add_field("lod_depth")
-                .add_field("time_to_first_rep")
-                .add_field("num_types_of_tasks")
-                .add_field("num_germ")
-                .add_field("num_pop")
-                .add_field("germ_percent")
-                .add_field("mean_germ_workload")
-                .add_field("mean_germ_workload_var")
-                .add_field("mean_soma_workload")
-                .add_field("mean_soma_workload_var");
-                
-                int lod_depth = 0;
-                // skip def ancestor (that's what the +1 does)
-                for( ; i!=lod.end(); ++i) {
-                    
-                    df.write(lod_depth);
-                    
-                    // **i is the EA, AS OF THE TIME THAT IT DIED!
-                    
-                    // To replay, need to create new eas for each knockout exper.
-                    // setup the population (really, an ea):
-                    typename EA::individual_ptr_type control_ea = ea.make_individual();
-                    control_ea->rng().reset(get<RNG_SEED>(**i));
-                    
-                    // setup the founder
-                    typename EA::individual_type::individual_ptr_type o= (*i)->make_individual((*i)->founder().repr());
-                    o->hw().initialize();
-                    control_ea->append(o);
-                    
-                    // replay! till the group amasses the right amount of resources
-                    // or exceeds its window...
-                    int cur_update = 0;
-                    int update_max = 10000;
-                    // and run till the group amasses the right amount of resources
-                    while ((get<GROUP_RESOURCE_UNITS>(*control_ea,0) < get<GROUP_REP_THRESHOLD>(*control_ea)) &&
-                           (cur_update < update_max)){
-                        control_ea->update();
-                        ++cur_update;
-                    }
-                    
-                    double germ_count = 0;
-                    double pop_count = 0;
-                    accumulator_set<double, stats<tag::mean, tag::variance> > germ_workload_acc;
-                    accumulator_set<double, stats<tag::mean, tag::variance> > soma_workload_acc;
-                    
-                    for(typename EA::individual_type::population_type::iterator j=control_ea->population().begin(); j!=control_ea->population().end(); ++j) {
-                        typename EA::individual_type::individual_type& org=**j;
-                        if (get<GERM_STATUS>(org, true)) {
-                            ++germ_count;
-                            germ_workload_acc(get<WORKLOAD>(org, 0.0));
-                        } else {
-                            soma_workload_acc(get<WORKLOAD>(org, 0.0));
-                        }
-                        ++pop_count;
-                    }
-                    
-                    
-                    // How many different types of tasks does the group do?
-                    int task_type_count = 0;
-                    if (get<TASK_NOT>(*control_ea,0.0)) ++task_type_count;
-                    if (get<TASK_NAND>(*control_ea,0.0)) ++task_type_count;
-                    if (get<TASK_AND>(*control_ea,0.0)) ++task_type_count;
-                    if (get<TASK_ORNOT>(*control_ea,0.0)) ++task_type_count;
-                    if (get<TASK_OR>(*control_ea,0.0)) ++task_type_count;
-                    if (get<TASK_ANDNOT>(*control_ea,0.0)) ++task_type_count;
-                    if (get<TASK_NOR>(*control_ea,0.0)) ++task_type_count;
-                    if (get<TASK_XOR>(*control_ea,0.0)) ++task_type_count;
-                    if (get<TASK_EQUALS>(*control_ea,0.0)) ++task_type_count;
-
-                    
-                    
-                    
-                    double germ_percent = (germ_count/pop_count);
-                    df.write(cur_update)
-                    .write(task_type_count)
-                    .write(germ_count)
-                    .write(pop_count)
-                    .write(germ_percent)
-                    .write(mean(germ_workload_acc))
-                    .write(variance(germ_workload_acc));
-                    
-                    if (germ_count != pop_count){
-                        df.write(mean(soma_workload_acc))
-                        .write(variance(soma_workload_acc));
-                    } else {
-                        df.write(0)
-                        .write(0); 
-                    }
-                    
-                    
-                    df.endl();
-                    
-                    ++lod_depth;
+                df.add_field("lod_depth");
+                for (std::size_t k=0; k<columns.size(); ++k) {
+                    df.add_field(columns[k]);
                 }
+                
+                write_lod_samples(df, lod_sample(replay, replay.size(), columns, 1, ea));
             }
             
             
@@ -428,8 +354,6 @@ LIBEA_ANALYSIS_TOOL(lod_gls_task_count) {
 
                 line_of_descent<EA> lod = lod_load(get<ANALYSIS_INPUT>(ea), ea);
                 
-                typename line_of_descent<EA>::iterator i=lod.begin(); ++i;
-                
                 datafile df("lod_tasks.dat");
                 df.add_field("lod_depth")
                 .add_field("not")
@@ -440,36 +364,19 @@ LIBEA_ANALYSIS_TOOL(lod_gls_task_count) {
                 .add_field("andnot")
                 .add_field("nor")
                 .add_field("xor")
-                .add_field("equals");
+                .add_field("equals")
+                .add_field("replay_stop");
                 
-                int lod_depth = 0;
-                // skip def ancestor (that's what the +1 does)
-                for( ; i!=lod.end(); ++i) {
+                lod_replay<EA> replay(lod, ea);
+                for (int lod_depth=0; lod_depth<replay.size(); ++lod_depth) {
                     
                     df.write(lod_depth);
                     
-                    // **i is the EA, AS OF THE TIME THAT IT DIED!
-                    
-                    // To replay, need to create new eas for each knockout exper.
-                    // setup the population (really, an ea):
-                    typename EA::individual_ptr_type control_ea = ea.make_individual();
-                    control_ea->rng().reset(get<RNG_SEED>(**i));
-                    
-                    // setup the founder
-                    typename EA::individual_type::individual_ptr_type o= (*i)->make_individual((*i)->founder().repr());
-                    o->hw().initialize();
-                    control_ea->append(o);
+                    typename EA::individual_ptr_type control_ea = replay.founder_ea(lod_depth);
                     
                     // replay! till the group amasses the right amount of resources
                     // or exceeds its window...
-                    int cur_update = 0;
-                    int update_max = 10000;
-                    // and run till the group amasses the right amount of resources
-                    while ((get<GROUP_RESOURCE_UNITS>(*control_ea,0) < get<GROUP_REP_THRESHOLD>(*control_ea)) &&
-                           (cur_update < update_max)){
-                        control_ea->update();
-                        ++cur_update;
-                    }
+                    replay_result r = replay.replay_to_threshold(*control_ea, 10000);
                     
                    
                     // How many different types of tasks does the group do?
@@ -481,12 +388,11 @@ LIBEA_ANALYSIS_TOOL(lod_gls_task_count) {
                     .write(get<TASK_ANDNOT>(*control_ea,0.0))
                     .write(get<TASK_NOR>(*control_ea,0.0))
                     .write(get<TASK_XOR>(*control_ea,0.0))
-                    .write(get<TASK_EQUALS>(*control_ea,0.0));
+                    .write(get<TASK_EQUALS>(*control_ea,0.0))
+                    .write(r.stop);
                     
                     
                     df.endl();
-                    
-                    ++lod_depth;
                 }
             }
             
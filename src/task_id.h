@@ -0,0 +1,95 @@
+//
+//  task_id.h
+//  ealife
+//
+//  Copyright (c) 2013 Michigan State University. All rights reserved.
+//
+
+#ifndef _EALIFE_TASK_ID_H_
+#define _EALIFE_TASK_ID_H_
+
+#include <string>
+#include <vector>
+#include <ea/meta_data.h>
+
+using namespace ealib;
+
+//! Interned id of the last task an organism performed; -1 if none.
+LIBEA_MD_DECL(LAST_TASK_ID, "ea.ts.last_task_id", int);
+
+//! A task's own interned id, kept on the task by task_ids::id.
+LIBEA_MD_DECL(TASK_ID, "ea.ts.task_id", int);
+
+
+/*! Interned task names.
+
+ Tasks are identified on organisms by a small integer id rather than by name,
+ so that organism meta-data holds an int and comparing tasks does not build or
+ compare strings.  Ids are looked up by task name: each subpopulation builds
+ its own task objects, so a task's address says nothing about which task it
+ is.
+
+ Ids end up in organism meta-data, and so in checkpoints and LOD files, so
+ they must mean the same thing in every process.  The nine logic tasks are
+ therefore always ids 0-8, in the column order of tasks.dat (not, nand, and,
+ ornot, or, andnot, nor, xor, equals), whatever order they are first used in.
+ Any other task is assigned the next id on first use, which is only stable
+ within a process.
+
+ A task's id is looked up by name only once, the first time it is asked for,
+ and is then kept in the task's meta-data (TASK_ID); reaction events read
+ that int rather than the name.
+ */
+class task_ids {
+public:
+    //! Returns the id of the task named n, interning it if needed.
+    static int id(const std::string& n) {
+        std::vector<std::string>& names = instance()._names;
+        for(std::size_t i=0; i<names.size(); ++i) {
+            if(names[i] == n) {
+                return static_cast<int>(i);
+            }
+        }
+        names.push_back(n);
+        return static_cast<int>(names.size() - 1);
+    }
+
+    //! Returns the id of the task named n (without this, literals would pick the template below).
+    static int id(const char* n) {
+        return id(std::string(n));
+    }
+
+    //! Returns the id of task t, looking up its name only on first use.
+    template <typename Task>
+    static int id(Task& t) {
+        int& i = get<TASK_ID>(t, -1);
+        if(i < 0) {
+            i = id(t.name());
+        }
+        return i;
+    }
+
+    //! Returns the name of task id i, or "" for an unknown id.
+    static const std::string& name(int i) {
+        static const std::string none;
+        const std::vector<std::string>& names = instance()._names;
+        return ((i >= 0) && (static_cast<std::size_t>(i) < names.size())) ? names[i] : none;
+    }
+
+protected:
+    //! Constructor; interns the logic tasks in their fixed order.
+    task_ids() {
+        static const char* logic[] = { "not", "nand", "and", "ornot", "or", "andnot", "nor", "xor", "equals" };
+        _names.assign(logic, logic + sizeof(logic)/sizeof(logic[0]));
+    }
+
+    //! Returns the process-wide table.
+    static task_ids& instance() {
+        static task_ids t;
+        return t;
+    }
+
+    std::vector<std::string> _names; //!< Task names, indexed by id.
+};
+
+#endif
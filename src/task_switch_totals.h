@@ -0,0 +1,43 @@
+//
+//  task_switch_totals.h
+//  ealife
+//
+//  Copyright (c) 2013 Michigan State University. All rights reserved.
+//
+
+#ifndef _EALIFE_TASK_SWITCH_TOTALS_H_
+#define _EALIFE_TASK_SWITCH_TOTALS_H_
+
+#include <ea/meta_data.h>
+
+using namespace ealib;
+
+LIBEA_MD_DECL(NUM_SWITCHES, "ea.ts.num_switches", int);
+
+// running per-subpopulation totals kept for task_switch_tracking:
+LIBEA_MD_DECL(TS_SWITCH_TOTAL, "ea.ts.switch_total", int);
+LIBEA_MD_DECL(TS_LIVE_ORGS, "ea.ts.live_orgs", int);
+
+
+/*! Set the task-switch totals in md from the organisms of pop.
+
+ The totals are kept up to date by task_switching_cost, ts_birth_event and
+ ts_death_event, but organisms placed in a group directly (the founders of a
+ new group, or a restored checkpoint) are not born; whoever places them calls
+ this, or adds them to the totals itself.
+ */
+template <typename Population, typename MetaData>
+void ts_count_totals(Population& pop, MetaData& md) {
+    int ts = 0;
+    int org = 0;
+    for(typename Population::iterator j=pop.begin(); j!=pop.end(); ++j) {
+        if((**j).alive()) {
+            ts += get<NUM_SWITCHES>(**j, 0);
+            ++org;
+        }
+    }
+    put<TS_SWITCH_TOTAL>(ts, md);
+    put<TS_LIVE_ORGS>(org, md);
+}
+
+#endif
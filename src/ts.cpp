@@ -20,6 +20,7 @@
 
 #include "ts.h"
 #include "shannon_mutual_lod_tasks_orgs.h"
+#include "compact_checkpoint.h"
 
 #include <ea/digital_evolution/population_founder.h>
 #include <ea/line_of_descent.h>
@@ -70,6 +71,7 @@ struct ts_configuration : public abstract_configuration<EA> {
         add_event<task_resource_consumption>(this,ea);
         add_event<task_switching_cost>(this, ea);
         add_event<ts_birth_event>(this,ea);
+        add_event<ts_death_event>(this,ea);
 
     }
     
@@ -140,10 +142,22 @@ struct mp_configuration : public abstract_configuration<EA> {
 
 //! Meta-population definition.
 typedef meta_population<
-population_lod<population_founder<ea_type> >,
+population_lod<subpopulation_founder<ea_type> >,
 mp_configuration> mea_type;
 
 
+//! Compact checkpoints also keep each organism's switch count; the group totals are recounted on restore.
+template <>
+struct checkpoint_traits<mea_type> : default_checkpoint_traits<mea_type> {
+    typedef default_checkpoint_traits<mea_type> base_type;
+    
+    static void organism_columns(compact_checkpoint::schema<organism_type>& s) {
+        base_type::organism_columns(s);
+        s.add<NUM_SWITCHES>();
+    }
+};
+
+
 /*! 
  */
 template <typename EA>
@@ -167,16 +181,24 @@ public:
         add_option<RUN_UPDATES>(this);
         add_option<RUN_EPOCHS>(this);
         add_option<CHECKPOINT_PREFIX>(this);        
+        add_option<COMPACT_CHECKPOINT_PERIOD>(this);
+        add_option<COMPACT_CHECKPOINT_INPUT>(this);
+        add_option<COMPACT_CHECKPOINT_ASYNC>(this);
+        add_option<COMPACT_CHECKPOINT_KEYFRAME>(this);
         add_option<RNG_SEED>(this);
         add_option<RECORDING_PERIOD>(this);
         
         add_option<ANALYSIS_INPUT>(this);
+        add_option<LOD_SAMPLING_STRIDE>(this);
+        add_option<LOD_SAMPLING_ADAPTIVE>(this);
+        add_option<LOD_SAMPLING_TOLERANCE>(this);
+        add_option<LOD_SAMPLING_METRIC>(this);
         
         // ts specific options
         add_option<GROUP_REP_THRESHOLD>(this);
         add_option<TASK_SWITCHING_COST>(this);
-        add_option<LAST_TASK>(this);
         add_option<NUM_SWITCHES>(this);
+        add_option<TS_TRACKING_PERIOD>(this);
         add_option<GERM_MUTATION_PER_SITE_P>(this);
         
         // initial amount (unit), inflow (unit), outflow (percentage), percent consumed
@@ -188,6 +210,8 @@ public:
     
     virtual void gather_tools() {
         add_tool<ealib::analysis::lod_shannon_tasks_orgs>(this);
+        add_tool<ealib::analysis::compact_checkpoint_convert>(this);
+        add_tool<ealib::analysis::compact_checkpoint_roundtrip>(this);
     }
     
     virtual void gather_events(EA& ea) {
@@ -195,7 +219,8 @@ public:
         add_event<task_performed_tracking>(this,ea);
         add_event<task_switch_tracking>(this,ea);
         add_event<datafiles::mrca_lineage>(this,ea);
-        add_event<population_founder_event>(this,ea);
+        add_event<founder_event>(this,ea);
+        add_event<compact_checkpoint_event>(this,ea);
     };
 };
 LIBEA_CMDLINE_INSTANCE(mea_type, cli);
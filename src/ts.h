@@ -21,6 +21,9 @@
 #include "repro_not_ancestor.h"
 #include "resource_consumption.h"
 #include "configurable_mutation.h"
+#include "subpopulation_founder.h"
+#include "task_id.h"
+#include "task_switch_totals.h"
 
 
 #include <ea/digital_evolution.h>
@@ -37,10 +40,9 @@ using namespace ealib;
 using namespace boost::accumulators;
 
 LIBEA_MD_DECL(TASK_SWITCHING_COST, "ea.ts.task_switching_cost", int);
-LIBEA_MD_DECL(LAST_TASK, "ea.ts.last_task", std::string);
-LIBEA_MD_DECL(NUM_SWITCHES, "ea.ts.num_switches", int);
 LIBEA_MD_DECL(GERM_MUTATION_PER_SITE_P, "ea.ts.germ_mutation_per_site_p", double);
 LIBEA_MD_DECL(NUM_GROUP_REPLICATIONS, "ea.ts.num_group_replications", int);
+LIBEA_MD_DECL(TS_TRACKING_PERIOD, "ea.ts.tracking_period", int);
 
 
 LIBEA_MD_DECL(RES_INITIAL_AMOUNT, "ea.ts.res_initial_amount", double);
@@ -52,6 +54,8 @@ LIBEA_MD_DECL(RES_FRACTION_CONSUMED, "ea.ts.res_fraction_consumed", double);
 
 
 /*! If an organism changes tasks, then it incurs a task-switching cost.
+ 
+ The last task is kept as an interned id (LAST_TASK_ID); see task_id.h.
  */
 
 template <typename EA>
@@ -66,25 +70,32 @@ struct task_switching_cost : reaction_event<EA> {
                             double r, // amount of resource consumed
                             EA& ea) {
         
-        if (exists<LAST_TASK>(ind) && 
-            (task->name() != get<LAST_TASK>(ind, ""))) {
+        int t = task_ids::id(*task);
+        int last = get<LAST_TASK_ID>(ind, -1);
+        if ((last != -1) && (t != last)) {
             
             ind.hw().add_cost(get<TASK_SWITCHING_COST>(ea)); 
             get<NUM_SWITCHES>(ind, 0) += 1; 
+            get<TS_SWITCH_TOTAL>(ea, 0) += 1;
         }
-        put<LAST_TASK>(task->name(), ind); 
+        put<LAST_TASK_ID>(t, ind);
         
     }
 };
 
 
-/*! Prints information about the mean number of task-switches
+/*! Prints information about the mean number of task-switches.
+ 
+ Rows are written every ea.ts.tracking_period updates (default 100; values
+ below 1 are treated as 1) from the running totals that task_switching_cost,
+ ts_birth_event and ts_death_event keep on each subpopulation, so a row costs
+ one pass over the subpopulations rather than over every organism.  Groups
+ set their totals when they are founded (see ts_count_totals); the first row
+ counts every group from its organisms, which covers the initial population.
  */
-
-
 template <typename EA>
 struct task_switch_tracking : end_of_update_event<EA> {
-    task_switch_tracking(EA& ea) : end_of_update_event<EA>(ea), _df("ts.dat") { 
+    task_switch_tracking(EA& ea) : end_of_update_event<EA>(ea), _df("ts.dat"), _counted(false) { 
         _df.add_field("update")
         .add_field("sub_pop_size")
         .add_field("pop_size")
@@ -99,7 +110,14 @@ struct task_switch_tracking : end_of_update_event<EA> {
     
     //! Track how many task-switches are being performed!
     virtual void operator()(EA& ea) {
-        if ((ea.current_update() % 100) == 0) {
+        if (!_counted) {
+            for(typename EA::iterator i=ea.begin(); i!=ea.end(); ++i) {
+                ts_count_totals(i->population(), *i);
+            }
+            _counted = true;
+        }
+        
+        if ((ea.current_update() % std::max(get<TS_TRACKING_PERIOD>(ea, 100), 1)) == 0) {
             double ts = 0;
             double org = 0;
             
@@ -107,13 +125,8 @@ struct task_switch_tracking : end_of_update_event<EA> {
             
             for(typename EA::iterator i=ea.begin(); i!=ea.end(); ++i) {
                 ++sub_pop_size;
-                for(typename EA::subpopulation_type::iterator j=i->population().begin(); j!=i->population().end(); ++j){
-                    typename EA::subpopulation_type::individual_type& ind=**j;
-                    if (ind.alive()) {
-                        ts += get<NUM_SWITCHES>(ind, 0);
-                        ++org;
-                    }
-                }
+                ts += get<TS_SWITCH_TOTAL>(*i, 0);
+                org += get<TS_LIVE_ORGS>(*i, 0);
             }
             ts /= org;
             _df.write(ea.current_update())
@@ -128,7 +141,7 @@ struct task_switch_tracking : end_of_update_event<EA> {
         
     }
     datafile _df;    
-    
+    bool _counted; //!< True once every group's totals have been counted.
 };
 
 
@@ -160,8 +173,7 @@ struct ts_replication : end_of_update_event<EA> {
                 
                 // grab a copy of the founder!
                 
-                typename EA::individual_type::individual_type prop = (*i).founder();
-                prop.repr().resize((*i).founder().hw().original_size());
+                typename EA::individual_type::individual_type prop(founder_genome((*i).founder()));
 
                 prop.hw().initialize();
                 
@@ -176,6 +188,7 @@ struct ts_replication : end_of_update_event<EA> {
                 // and fill up the offspring population with copies of the germ:
                 typename EA::individual_type::individual_ptr_type o=p->make_individual(prop.repr());
                 p->append(o);
+                ts_count_totals(p->population(), *p);
                 offspring.push_back(p);
                 
                 // reset resource units
@@ -235,10 +248,31 @@ struct ts_birth_event : birth_event<EA> {
                             EA& ea) {
         ea.env().face_org(parent, offspring);
         
+        get<TS_LIVE_ORGS>(ea, 0) += 1;
+        get<TS_SWITCH_TOTAL>(ea, 0) += get<NUM_SWITCHES>(offspring, 0);
     }
 };
 
 
+/*! Removes a dying organism from its subpopulation's task-switch totals.
+ */
+template <typename EA>
+struct ts_death_event : death_event<EA> {
+    
+    //! Constructor.
+    ts_death_event(EA& ea) : death_event<EA>(ea) {
+    }
+    
+    //! Destructor.
+    virtual ~ts_death_event() {
+    }
+    
+    virtual void operator()(typename EA::individual_type& ind, EA& ea) {
+        get<TS_LIVE_ORGS>(ea, 0) -= 1;
+        get<TS_SWITCH_TOTAL>(ea, 0) -= get<NUM_SWITCHES>(ind, 0);
+    }
+};
+
 
 #endif
 
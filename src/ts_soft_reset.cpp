@@ -72,6 +72,7 @@ struct ts_configuration : public abstract_configuration<EA> {
         add_event<task_resource_consumption>(this,ea);
         add_event<task_switching_cost>(this, ea);
         add_event<ts_birth_event>(this,ea);
+        add_event<ts_death_event>(this,ea);
         
     }
     
@@ -142,7 +143,7 @@ struct mp_configuration : public abstract_configuration<EA> {
 
 //! Meta-population definition.
 typedef meta_population<
-population_lod<population_founder<ea_type> >,
+population_lod<subpopulation_founder<ea_type> >,
 mp_configuration> mea_type;
 
 
@@ -173,12 +174,17 @@ public:
         add_option<RECORDING_PERIOD>(this);
         
         add_option<ANALYSIS_INPUT>(this);
+        add_option<LOD_SAMPLING_STRIDE>(this);
+        add_option<LOD_SAMPLING_ADAPTIVE>(this);
+        add_option<LOD_SAMPLING_TOLERANCE>(this);
+        add_option<LOD_SAMPLING_METRIC>(this);
+        add_option<LOD_REPLAY_SNAPSHOT_PERIOD>(this);
         
         // ts specific options
         add_option<GROUP_REP_THRESHOLD>(this);
         add_option<TASK_SWITCHING_COST>(this);
-        add_option<LAST_TASK>(this);
         add_option<NUM_SWITCHES>(this);
+        add_option<TS_TRACKING_PERIOD>(this);
         add_option<GERM_MUTATION_PER_SITE_P>(this);
         
         // initial amount (unit), inflow (unit), outflow (percentage), percent consumed
@@ -191,6 +197,8 @@ public:
     virtual void gather_tools() {
         add_tool<ealib::analysis::lod_shannon_tasks_orgs>(this);
         add_tool<ealib::analysis::lod_knockouts>(this);
+        add_tool<ealib::analysis::lod_late_knockouts>(this);
+        add_tool<ealib::analysis::lod_fork_check>(this);
 
     }
     
@@ -199,7 +207,7 @@ public:
         add_event<task_performed_tracking>(this,ea);
         add_event<task_switch_tracking>(this,ea);
         add_event<datafiles::mrca_lineage>(this,ea);
-        add_event<population_founder_event>(this,ea);
+        add_event<founder_event>(this,ea);
     };
 };
 LIBEA_CMDLINE_INSTANCE(mea_type, cli);